@@ -0,0 +1,123 @@
+/*************************************************************************
+* Detouring::CallProfiler
+* Generated stubs counting calls and cycles on their way to a target.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "helpers.hpp"
+#include "platform.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace Detouring
+{
+	// One stub per target, calls through a stub are counted in per thread shards and jump to its target
+	class CallProfiler
+	{
+	public:
+		struct Result
+		{
+			uint64_t calls;
+			uint64_t cycles;
+		};
+
+		CallProfiler( ) = default;
+
+		CallProfiler( const CallProfiler & ) = delete;
+		CallProfiler( CallProfiler && ) = delete;
+
+		~CallProfiler( );
+
+		CallProfiler &operator=( const CallProfiler & ) = delete;
+		CallProfiler &operator=( CallProfiler && ) = delete;
+
+		// Measuring cycles replaces return addresses while a target runs, so exceptions must not
+		// unwind through it, and it's only available on x86-64 outside of Windows
+		static bool IsCyclesSupported( );
+
+		bool IsValid( ) const;
+
+		bool Create( void *const *targets, size_t count, bool measure_cycles = false, void *nearby = nullptr );
+
+		// No thread may be running through a stub when they're freed
+		bool Destroy( );
+
+		bool IsMeasuringCycles( ) const;
+
+		size_t GetSize( ) const;
+
+		void *GetStub( size_t index ) const;
+
+		void *GetTarget( size_t index ) const;
+
+		// Sums the shards, cycles are inclusive of nested calls and zero unless measured
+		Result GetResult( size_t index ) const;
+
+		void Reset( );
+
+	private:
+		struct Site
+		{
+			std::atomic<uint64_t> *counters;
+			size_t stride;
+		};
+
+		// Counters are cache line aligned so shards never share a line
+		struct CounterDeleter
+		{
+			void operator()( std::atomic<uint64_t> *counters ) const;
+		};
+
+		static void EnterCall( Site *site, void **return_slot );
+		static void *LeaveCall( );
+		static uint8_t *GetReturnStub( );
+		static void WriteCyclesStub( uint8_t *code, Site *site, void *target );
+
+		size_t GetStubSize( ) const;
+
+		size_t size = 0;
+		bool measure_cycles = false;
+		uint8_t *stubs = nullptr;
+		std::vector<void *> targets;
+
+		// Call and cycle pairs for every target, repeated once per shard
+		size_t shard_stride = 0;
+		std::unique_ptr<std::atomic<uint64_t>[], CounterDeleter> counters;
+		std::unique_ptr<Site[]> sites;
+	};
+}
@@ -0,0 +1,128 @@
+/*************************************************************************
+* Detouring::CallSiteHook
+* A C++ class that allows you to redirect the direct calls to a function
+* without modifying the function itself.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "hook.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace Detouring
+{
+	class CallSiteHook
+	{
+	public:
+		CallSiteHook( ) = default;
+		CallSiteHook( const Hook::Target &target, void *detour );
+		CallSiteHook( const Hook::Target &target, void *detour, const std::vector<Hook::Module> &modules );
+
+		CallSiteHook( const CallSiteHook & ) = delete;
+		CallSiteHook( CallSiteHook && ) = delete;
+
+		~CallSiteHook( );
+
+		CallSiteHook &operator=( const CallSiteHook & ) = delete;
+		CallSiteHook &operator=( CallSiteHook && ) = delete;
+
+		bool IsValid( ) const;
+
+		// Without a list of modules, the call sites of every loaded module are rewritten
+		// Only code sections are scanned, so modules whose file has no section headers are skipped
+		// Call sites are only rewritten when the sweep stays in step with the known function starts
+		bool Create( const Hook::Target &target, void *detour );
+		bool Create( const Hook::Target &target, void *detour, const std::vector<Hook::Module> &modules );
+		bool Destroy( );
+
+		bool IsEnabled( ) const;
+		bool Enable( );
+		bool Disable( );
+
+		size_t GetSiteCount( ) const;
+
+		void *GetTarget( ) const;
+
+		template<typename Method>
+		Method GetTarget( ) const
+		{
+			return reinterpret_cast<Method>( GetTarget( ) );
+		}
+
+		void *GetDetour( ) const;
+
+		template<typename Method>
+		Method GetDetour( ) const
+		{
+			return reinterpret_cast<Method>( GetDetour( ) );
+		}
+
+		// The target is left untouched and is callable as is
+		void *GetTrampoline( ) const;
+
+		template<typename Method>
+		Method GetTrampoline( ) const
+		{
+			return reinterpret_cast<Method>( GetTrampoline( ) );
+		}
+
+	private:
+		struct Site
+		{
+			uint8_t *displacement;
+			int32_t original;
+			int32_t redirected;
+		};
+
+		struct Region
+		{
+			uintptr_t start;
+			uintptr_t end;
+			int32_t protection;
+			std::vector<Site> sites;
+		};
+
+		bool Scan( const std::vector<Hook::Module> &modules );
+		void *GetRelay( uint8_t *next );
+		bool Write( bool redirect );
+
+		std::vector<Region> regions;
+		std::vector<void *> relays;
+		void *target = nullptr;
+		void *detour = nullptr;
+		bool enabled = false;
+	};
+}
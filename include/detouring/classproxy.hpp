@@ -39,21 +39,29 @@
 
 #include "hook.hpp"
 #include "helpers.hpp"
+#include "interfaceindex.hpp"
 #include "platform.hpp"
+#include "pointermap.hpp"
+#include "rtti.hpp"
 
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
 #include <vector>
-#include <unordered_map>
+#include <string>
 #include <utility>
+#include <functional>
+#include <initializer_list>
 #include <memory>
 #include <mutex>
+#include <atomic>
 #include <stdexcept>
 
 namespace Detouring
 {
-	typedef std::unordered_map<void *, Member> CacheMap;
-	typedef std::unordered_map<void *, Detouring::Hook> HookMap;
+	typedef PointerMap<Member> CacheMap;
+	typedef PointerMap<std::unique_ptr<Detouring::Hook>> HookMap;
+	typedef PointerMap<void *> TrampolineMap;
 
 	template<typename Target, typename Substitute>
 	class ClassProxy
@@ -68,14 +76,17 @@ namespace Detouring
 
 		virtual ~ClassProxy( ) = default;
 
+	private:
+		class SharedState;
+
 	public:
 		static bool Initialize( Target *instance, Substitute *substitute )
 		{
-			auto shared_state = GetSharedState( );
-			if( !shared_state )
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
 				return false;
 
-			return shared_state->Initialize( instance, substitute );
+			return shared_state->Initialize( GetVirtualTable( instance ), instance, substitute );
 		}
 
 		inline bool Initialize( Target *instance )
@@ -83,11 +94,101 @@ namespace Detouring
 			return Initialize( instance, static_cast<Substitute *>( this ) );
 		}
 
+		// Allows hooking before any Target is constructed, vtable being the address point of its primary table
+		static bool Initialize( void **vtable, Substitute *substitute )
+		{
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
+				return false;
+
+			return shared_state->Initialize( vtable, nullptr, substitute );
+		}
+
+		inline bool Initialize( void **vtable )
+		{
+			return Initialize( vtable, static_cast<Substitute *>( this ) );
+		}
+
+		// Takes the mangled class name, as used in _ZTV<name> symbols
+		inline bool Initialize( const Hook::Module &module, const std::string &name )
+		{
+			return Initialize( Rtti::FindVirtualTable( module, name ) );
+		}
+
+		// Takes the versioned interface name, as passed to CreateInterface
+		inline bool Initialize( const InterfaceIndex &index, const std::string &name )
+		{
+			Target *instance = index.CreateInterface<Target>( name );
+			return instance != nullptr && Initialize( instance );
+		}
+
 		inline Target *This( )
 		{
 			return reinterpret_cast<Target *>( this );
 		}
 
+		// Holds the address that calls the original method, resolved when hooking
+		// Converts to bool like the result of Hook used to, and is invalidated by UnHook
+		template<typename Definition>
+		class HookHandle
+		{
+		public:
+			HookHandle( ) = default;
+
+			explicit HookHandle( void *_address, ptrdiff_t _adjustment = 0 ) :
+				address( _address ),
+				adjustment( _adjustment )
+			{ }
+
+			// Trampolines of inline hooks are freed by UnHook, the handle checks they're still published
+			HookHandle( void *_address, ptrdiff_t _adjustment, void *_hooked ) :
+				address( _address ),
+				adjustment( _adjustment ),
+				hooked( _hooked )
+			{ }
+
+			operator bool( ) const
+			{
+				return GetOriginal( ) != nullptr;
+			}
+
+			void *GetOriginal( ) const
+			{
+				if( hooked == nullptr )
+					return address;
+
+				SharedState *shared_state = GetSharedStatePointer( );
+				if( shared_state == nullptr || GetTrampoline( shared_state, hooked ) != address )
+					return nullptr;
+
+				return address;
+			}
+
+			template<
+				typename... Args,
+				typename Traits = FunctionTraits<Definition>,
+				typename ReturnType = typename Traits::ReturnType
+			>
+			ReturnType CallOriginal( Target *instance, Args &&... args ) const
+			{
+				void *original = GetOriginal( );
+				if( original == nullptr )
+					return ReturnType( );
+
+				if constexpr( Traits::IsMemberFunctionPointer )
+					return CallMemberAddress<Definition>( instance, original, adjustment, std::forward<Args>( args )... );
+				else
+					return reinterpret_cast<Definition>( original )( instance, std::forward<Args>( args )... );
+			}
+
+		private:
+			friend class ClassProxy;
+
+			void *address = nullptr;
+			ptrdiff_t adjustment = 0;
+			void *hooked = nullptr;
+		};
+
 		template<
 			typename Definition,
 			typename Traits = FunctionTraits<Definition>,
@@ -95,11 +196,11 @@ namespace Detouring
 		>
 		static bool IsHooked( Definition original )
 		{
-			const auto shared_state = GetSharedState( );
-			if( !shared_state )
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
 				return false;
 
-			return shared_state->hooks.find( reinterpret_cast<void*>( original ) ) != shared_state->hooks.end( );
+			return GetTrampoline( shared_state, reinterpret_cast<void *>( original ) ) != nullptr;
 		}
 
 		template<
@@ -109,14 +210,18 @@ namespace Detouring
 		>
 		static bool IsHooked( Definition original )
 		{
-			const auto shared_state = GetSharedState( );
-			if( !shared_state )
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
 				return false;
 
-			const auto it = shared_state->hooks.find( GetAddress( original ) );
-			if( it != shared_state->hooks.end( ) )
+			if( GetTrampoline( shared_state, GetAddress( original ) ) != nullptr )
 				return true;
 
+			size_t index = 0;
+			const SecondaryVTable *secondary = GetSecondaryVirtualTable( shared_state, original, index );
+			if( secondary != nullptr )
+				return secondary->pointer[index] != secondary->original[index];
+
 			Member vtarget = GetVirtualAddress( shared_state->target_vtable, original );
 			if( !vtarget.IsValid( ) )
 				return false;
@@ -127,94 +232,105 @@ namespace Detouring
 		template<
 			typename DefinitionOriginal,
 			typename DefinitionSubstitute,
-			typename TraitsOriginal = FunctionTraits<DefinitionOriginal>,
-			typename = FunctionTraits<DefinitionSubstitute>,
-			std::enable_if_t<!TraitsOriginal::IsMemberFunctionPointer, int> = 0
+			typename = FunctionTraits<DefinitionOriginal>,
+			typename = FunctionTraits<DefinitionSubstitute>
 		>
-		static bool Hook(
+		static HookHandle<DefinitionOriginal> Hook(
 			DefinitionOriginal original,
 			DefinitionSubstitute substitute
 		)
 		{
-			const auto shared_state = GetSharedState( );
-			if( !shared_state )
-				return false;
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
+				return { };
 
-			void *address = reinterpret_cast<void *>( original );
-			if( address == nullptr )
-				return false;
-
-			const auto it = shared_state->hooks.find( address );
-			if( it != shared_state->hooks.end( ) )
-				return true;
-
-			void *subst = GetAddress( substitute );
-			if( subst == nullptr )
-				return false;
+			std::lock_guard lock( shared_state->writer_mutex );
+			return HookLocked( shared_state, original, substitute, nullptr );
+		}
 
-			Detouring::Hook &hook = shared_state->hooks[address];
-			if( !hook.Create( address, subst ) )
+		// An original and substitute pair for HookMany, virtual slots are resolved on construction
+		class Binding
+		{
+		public:
+			template<
+				typename DefinitionOriginal,
+				typename DefinitionSubstitute,
+				typename TraitsOriginal = FunctionTraits<DefinitionOriginal>,
+				typename = FunctionTraits<DefinitionSubstitute>
+			>
+			Binding( DefinitionOriginal original, DefinitionSubstitute substitute )
 			{
-				shared_state->hooks.erase( address );
-				return false;
+				if constexpr( TraitsOriginal::IsMemberFunctionPointer )
+				{
+					SharedState *shared_state = GetSharedStatePointer( );
+					if( shared_state != nullptr )
+					{
+						const Member target = CacheVirtualAddress( shared_state->target_vtable, original );
+						const Member subst = CacheVirtualAddress( shared_state->substitute_vtable, substitute );
+						if( target.IsValid( ) && subst.IsValid( ) )
+						{
+							index = target.index;
+							address = subst.address;
+							return;
+						}
+					}
+				}
+
+				fallback = [original, substitute]( SharedState *shared_state, TrampolineMap &batch )
+				{
+					// Batched trampolines aren't published yet, so the handle can't validate itself
+					return HookLocked( shared_state, original, substitute, &batch ).address != nullptr;
+				};
 			}
 
-			return hook.Enable( );
-		}
+		private:
+			friend class ClassProxy;
 
-		template<
-			typename DefinitionOriginal,
-			typename DefinitionSubstitute,
-			typename TraitsOriginal = FunctionTraits<DefinitionOriginal>,
-			typename = FunctionTraits<DefinitionSubstitute>,
-			std::enable_if_t<TraitsOriginal::IsMemberFunctionPointer, int> = 0
-		>
-		static bool Hook(
-			DefinitionOriginal original,
-			DefinitionSubstitute substitute
-		)
+			size_t index = static_cast<size_t>( ~0 );
+			void *address = nullptr;
+			std::function<bool( SharedState *, TrampolineMap & )> fallback;
+		};
+
+		// Writes every virtual slot with a single protection change per run of pages,
+		// anything that isn't a virtual is hooked inline like Hook does and published in one map update
+		static bool HookMany( std::initializer_list<Binding> bindings )
 		{
-			const auto shared_state = GetSharedState( );
-			if( !shared_state )
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
 				return false;
 
-			Member target = GetVirtualAddress( shared_state->target_vtable, original );
-			if( target.IsValid( ) )
-			{
-				if( shared_state->target_vtable.pointer[target.index] != shared_state->original_vtable[target.index] )
-					return true;
+			std::lock_guard lock( shared_state->writer_mutex );
 
-				Member subst = GetVirtualAddress( shared_state->substitute_vtable, substitute );
-				if( !subst.IsValid( ) )
-					return false;
+			bool success = true;
 
-				ProtectMemory( shared_state->target_vtable.pointer + target.index, sizeof( void * ), false );
-				shared_state->target_vtable.pointer[target.index] = subst.address;
-				ProtectMemory( shared_state->target_vtable.pointer + target.index, sizeof( void * ), true );
+			std::vector<PointerPatch> patches;
+			patches.reserve( bindings.size( ) );
+			for( const Binding &binding : bindings )
+			{
+				if( binding.fallback )
+					continue;
 
-				return true;
+				void **slot = shared_state->target_vtable.pointer + binding.index;
+				if( *slot == shared_state->original_vtable[binding.index] )
+					patches.push_back( { slot, binding.address } );
 			}
 
-			void *address = GetAddress( original );
-			if( address == nullptr )
-				return false;
+			if( !patches.empty( ) && !WritePointers( patches.data( ), patches.size( ) ) )
+				success = false;
 
-			const auto it = shared_state->hooks.find( address );
-			if( it != shared_state->hooks.end( ) )
-				return true;
-
-			void *subst = GetAddress( substitute );
-			if( subst == nullptr )
-				return false;
+			TrampolineMap batch;
+			for( const Binding &binding : bindings )
+				if( binding.fallback && !binding.fallback( shared_state, batch ) )
+					success = false;
 
-			Detouring::Hook &hook = shared_state->hooks[address];
-			if( !hook.Create( address, subst ) )
-			{
-				shared_state->hooks.erase( address );
-				return false;
-			}
+			if( !batch.empty( ) )
+				shared_state->trampolines.Update( [&batch]( TrampolineMap &map )
+				{
+					for( const auto &entry : batch )
+						map[entry.first] = entry.second;
+				} );
 
-			return hook.Enable( );
+			return success;
 		}
 
 		template<
@@ -224,19 +340,26 @@ namespace Detouring
 		>
 		static bool UnHook( Definition original )
 		{
-			const auto shared_state = GetSharedState( );
-			if( !shared_state )
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
 				return false;
 
+			std::lock_guard lock( shared_state->writer_mutex );
+
 			void *address = reinterpret_cast<void *>( original );
 
 			const auto it = shared_state->hooks.find( address );
 			if ( it != shared_state->hooks.end( ) )
 			{
-				Detouring::Hook& hook = shared_state->hooks[address];
+				Detouring::Hook &hook = *it->second;
 				if ( hook.Disable( ) )
 				{
-					hook.Destroy( )
+					// Readers must stop finding the trampoline before it's freed
+					shared_state->trampolines.Update( [address]( TrampolineMap &map )
+					{
+						map.erase( address );
+					} );
+					hook.Destroy( );
 					shared_state->hooks.erase( it );
 					return true;
 				}
@@ -252,17 +375,29 @@ namespace Detouring
 		>
 		static bool UnHook( Definition original )
 		{
-			const auto shared_state = GetSharedState( );
-			if( !shared_state )
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
 				return false;
 
-			const auto it = shared_state->hooks.find( GetAddress( original ) );
+			std::lock_guard lock( shared_state->writer_mutex );
+
+			void *address = GetAddress( original );
+			const auto it = shared_state->hooks.find( address );
 			if( it != shared_state->hooks.end( ) )
 			{
+				shared_state->trampolines.Update( [address]( TrampolineMap &map )
+				{
+					map.erase( address );
+				} );
 				shared_state->hooks.erase( it );
 				return true;
 			}
 
+			size_t index = 0;
+			SecondaryVTable *secondary = GetSecondaryVirtualTable( shared_state, original, index );
+			if( secondary != nullptr )
+				return secondary->UnHook( index );
+
 			Member target = GetVirtualAddress( shared_state->target_vtable, original );
 			if( !target.IsValid( ) )
 				return false;
@@ -271,11 +406,7 @@ namespace Detouring
 			if( shared_state->target_vtable.pointer[target.index] == vfunction )
 				return false;
 
-			ProtectMemory( shared_state->target_vtable.pointer + target.index, sizeof( void * ), false );
-			shared_state->target_vtable.pointer[target.index] = vfunction;
-			ProtectMemory( shared_state->target_vtable.pointer + target.index, sizeof( void * ), true );
-
-			return true;
+			return WriteVirtual( shared_state, target.index, vfunction );
 		}
 
 		template<
@@ -291,15 +422,12 @@ namespace Detouring
 			Args &&... args
 		)
 		{
-			const auto shared_state = GetSharedState( );
-			if( !shared_state )
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
 				return ReturnType( );
 
-			void *address = reinterpret_cast<void *>( original ), *target = nullptr;
-			const auto it = shared_state->hooks.find( address );
-			if( it != shared_state->hooks.end( ) )
-				target = it->second.GetTrampoline( );
-
+			void *address = reinterpret_cast<void *>( original );
+			void *target = GetTrampoline( shared_state, address );
 			if( target == nullptr )
 				target = address;
 
@@ -323,15 +451,19 @@ namespace Detouring
 			Args &&... args
 		)
 		{
-			const auto shared_state = GetSharedState( );
-			if( !shared_state )
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
 				return ReturnType( );
 
 			void *address = GetAddress( original );
-			void *final_address = nullptr;
-			const auto it = shared_state->hooks.find( address );
-			if( it != shared_state->hooks.end( ) )
-				final_address = it->second.GetTrampoline( );
+			void *final_address = GetTrampoline( shared_state, address );
+			if( final_address == nullptr )
+			{
+				size_t index = 0;
+				const SecondaryVTable *secondary = GetSecondaryVirtualTable( shared_state, original, index );
+				if( secondary != nullptr )
+					final_address = secondary->original[index];
+			}
 
 			if( final_address == nullptr )
 			{
@@ -348,14 +480,12 @@ namespace Detouring
 				final_address = address;
 			}
 
-			struct CallMagic
-			{
-				const void *address = nullptr;
-				const size_t offset = 0;
-				const size_t unused[2] = { 0, 0 };
-			} func = { final_address };
-			auto typedfunc = reinterpret_cast<Definition *>( &func );
-			return ( instance->**typedfunc )( std::forward<Args>( args )... );
+			return CallMemberAddress<Definition>(
+				instance,
+				final_address,
+				GetThisAdjustment( original ),
+				std::forward<Args>( args )...
+			);
 		}
 
 		template<
@@ -369,89 +499,521 @@ namespace Detouring
 			return Call( This( ), original, std::forward<Args>( args )... );
 		}
 
+		// The following overloads take the methods as template arguments and skip the runtime lookups
+		// whenever the virtual table slot is encoded in the member function pointer (Itanium ABI)
+
+		template<
+			auto Original,
+			typename Traits = FunctionTraits<decltype( Original )>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		static bool IsHooked( )
+		{
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
+				return false;
+
+			const size_t index = GetPrimaryVirtualIndex<Original>( );
+			if( index < shared_state->target_vtable.size )
+				return shared_state->target_vtable.pointer[index] != shared_state->original_vtable[index];
+
+			return IsHooked( Original );
+		}
+
+		template<
+			auto Original,
+			auto SubstituteMethod,
+			typename Traits = FunctionTraits<decltype( Original )>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		static HookHandle<decltype( Original )> Hook( )
+		{
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
+				return { };
+
+			const size_t index = GetPrimaryVirtualIndex<Original>( );
+			const size_t subst_index = GetVirtualIndex<SubstituteMethod>( );
+			if( index >= shared_state->target_vtable.size || subst_index >= shared_state->substitute_vtable.size )
+				return Hook( Original, SubstituteMethod );
+
+			std::lock_guard lock( shared_state->writer_mutex );
+			HookHandle<decltype( Original )> handle( shared_state->original_vtable[index] );
+			if( shared_state->target_vtable.pointer[index] != shared_state->original_vtable[index] )
+				return handle;
+
+			if( !WriteVirtual( shared_state, index, shared_state->substitute_vtable.pointer[subst_index] ) )
+				return { };
+
+			return handle;
+		}
+
+		template<
+			auto Original,
+			typename Traits = FunctionTraits<decltype( Original )>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		static bool UnHook( )
+		{
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
+				return false;
+
+			const size_t index = GetPrimaryVirtualIndex<Original>( );
+			if( index >= shared_state->target_vtable.size )
+				return UnHook( Original );
+
+			std::lock_guard lock( shared_state->writer_mutex );
+			void *vfunction = shared_state->original_vtable[index];
+			if( shared_state->target_vtable.pointer[index] == vfunction )
+				return false;
+
+			return WriteVirtual( shared_state, index, vfunction );
+		}
+
+		template<
+			auto Original,
+			typename... Args,
+			typename Traits = FunctionTraits<decltype( Original )>,
+			typename ReturnType = typename Traits::ReturnType,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		static ReturnType Call( Target *instance, Args &&... args )
+		{
+			SharedState *shared_state = GetSharedStatePointer( );
+			if( shared_state == nullptr )
+				return ReturnType( );
+
+			const size_t index = GetPrimaryVirtualIndex<Original>( );
+			if( index < shared_state->target_vtable.size )
+				return CallMemberAddress<decltype( Original )>(
+					instance,
+					shared_state->original_vtable[index],
+					0,
+					std::forward<Args>( args )...
+				);
+
+			return Call( instance, Original, std::forward<Args>( args )... );
+		}
+
+		template<
+			auto Original,
+			typename... Args,
+			typename Traits = FunctionTraits<decltype( Original )>,
+			typename ReturnType = typename Traits::ReturnType,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		inline ReturnType Call( Args &&... args )
+		{
+			return Call<Original>( This( ), std::forward<Args>( args )... );
+		}
+
 	private:
+		// Readers look up the current map with a single acquire load, writers publish modified copies
+		// Replaced copies are kept until the map is destroyed since there's no telling when readers are done
+		template<typename Map>
+		class PublishedMap
+		{
+		public:
+			PublishedMap( ) = default;
+			PublishedMap( const PublishedMap & ) = delete;
+			PublishedMap( PublishedMap && ) = delete;
+
+			~PublishedMap( )
+			{
+				delete current.load( std::memory_order_relaxed );
+			}
+
+			PublishedMap &operator=( const PublishedMap & ) = delete;
+			PublishedMap &operator=( PublishedMap && ) = delete;
+
+			template<typename Value>
+			bool Find( const void *key, Value &value ) const
+			{
+				const Map *map = current.load( std::memory_order_acquire );
+				if( map == nullptr )
+					return false;
+
+				const auto it = map->find( key );
+				if( it == map->end( ) )
+					return false;
+
+				value = it->second;
+				return true;
+			}
+
+			template<typename Function>
+			void Update( Function &&function )
+			{
+				std::lock_guard lock( mutex );
+
+				const Map *previous = current.load( std::memory_order_relaxed );
+				std::unique_ptr<Map> next( previous != nullptr ? new Map( *previous ) : new Map );
+				function( *next );
+				current.store( next.release( ), std::memory_order_release );
+				if( previous != nullptr )
+					retired.emplace_back( previous );
+			}
+
+		private:
+			std::atomic<const Map *> current = nullptr;
+			std::mutex mutex;
+			std::vector<std::unique_ptr<const Map>> retired;
+		};
+
 		struct VTable
 		{
 			size_t size = 0;
 			void **pointer = nullptr;
-			CacheMap cache;
+			PublishedMap<CacheMap> cache;
 		};
 
+		// Table of a base subobject other than the first one, its entries expect this to point at that subobject
+		// Overriders have a slot in the primary table too, so &Base::Method and &Target::Method are hooked separately
+		struct SecondaryVTable
+		{
+			bool Hook( size_t index, void *substitute, bool returns_in_memory )
+			{
+				if( thunks == nullptr )
+				{
+					thunks = static_cast<uint8_t *>( AllocateExecutableBlock( size * Rtti::thunk_size ) );
+					if( thunks == nullptr )
+						return false;
+				}
+
+				void *thunk = thunks + index * Rtti::thunk_size;
+				if( !Rtti::WriteThisAdjustingThunk( thunk, offset, substitute, returns_in_memory ) )
+					return false;
+
+				PointerPatch patch = { pointer + index, thunk };
+				return WritePointers( &patch, 1 );
+			}
+
+			bool UnHook( size_t index )
+			{
+				if( pointer[index] == original[index] )
+					return false;
+
+				PointerPatch patch = { pointer + index, original[index] };
+				return WritePointers( &patch, 1 );
+			}
+
+			void Restore( )
+			{
+				std::vector<PointerPatch> patches;
+				for( size_t k = FindPointerMismatch( pointer, original.data( ), size ); k < size; )
+				{
+					patches.push_back( { pointer + k, original[k] } );
+					k += 1 + FindPointerMismatch( pointer + k + 1, original.data( ) + k + 1, size - k - 1 );
+				}
+
+				if( !patches.empty( ) )
+					WritePointers( patches.data( ), patches.size( ) );
+
+				if( thunks != nullptr )
+					FreeExecutableBlock( thunks, size * Rtti::thunk_size );
+			}
+
+			ptrdiff_t offset = 0;
+			void **pointer = nullptr;
+			size_t size = 0;
+			std::vector<void *> original;
+			uint8_t *thunks = nullptr;
+		};
+
+		template<typename Class, typename = void>
+		struct IsNonVirtualBase : std::false_type { };
+
+		template<typename Class>
+		struct IsNonVirtualBase<
+			Class,
+			std::void_t<decltype( static_cast<Target *>( std::declval<Class *>( ) ) )>
+		> : std::bool_constant<std::is_base_of_v<Class, Target>> { };
+
+		template<typename Definition>
+		struct TargetMember;
+
+		template<typename Type, typename Class>
+		struct TargetMember<Type Class::*>
+		{
+			typedef Type Target::*Definition;
+		};
+
+		// Distance from a Target instance to the subobject a method is called on, virtual bases aren't supported
+		// Converting to a Target member pointer adds the static offset of the base to its this adjustment
+		template<
+			typename Definition,
+			typename Traits = FunctionTraits<Definition>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		static ptrdiff_t GetSubobjectOffset( Definition method )
+		{
+			if constexpr( IsNonVirtualBase<typename Traits::TargetClass>::value )
+			{
+				const typename TargetMember<Definition>::Definition converted = method;
+
+#ifdef COMPILER_VC
+
+				// Multiple inheritance member pointers keep the adjustment right after the address
+				int32_t adjustment = 0;
+				if constexpr( sizeof( converted ) >= sizeof( void * ) + sizeof( adjustment ) )
+					std::memcpy( &adjustment, reinterpret_cast<const uint8_t *>( &converted ) + sizeof( void * ), sizeof( adjustment ) );
+
+				return adjustment;
+
+#else
+
+				return GetThisAdjustment( converted );
+
+#endif
+
+			}
+
+			return GetThisAdjustment( method );
+		}
+
+		// Slot in the primary table, or ~0 when the method lives in a secondary table
+		template<auto Method>
+		static size_t GetPrimaryVirtualIndex( )
+		{
+			static const size_t index =
+				GetSubobjectOffset( Method ) == 0 ? GetVirtualIndex( Method ) : static_cast<size_t>( ~0 );
+			return index;
+		}
+
+		// Only reads the cache, lookups on the call path never publish anything
 		template<
 			typename Definition,
 			typename Traits = FunctionTraits<Definition>,
 			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
 		>
 		static Member GetVirtualAddress(
+			const VTable &vtable,
+			Definition method
+		)
+		{
+			if( GetSubobjectOffset( method ) != 0 )
+				return Member( );
+
+			Member cached;
+			if( vtable.cache.Find( GetAddress( method ), cached ) )
+				return cached;
+
+			return Detouring::GetVirtualAddress( vtable.pointer, vtable.size, method );
+		}
+
+		// Called when hooking, so later calls through the proxy find the slot in the cache
+		template<
+			typename Definition,
+			typename Traits = FunctionTraits<Definition>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		static Member CacheVirtualAddress(
 			VTable &vtable,
 			Definition method
 		)
 		{
+			if( GetSubobjectOffset( method ) != 0 )
+				return Member( );
+
 			void *member = GetAddress( method );
-			const auto it = vtable.cache.find( member );
-			if( it != vtable.cache.end( ) )
-				return it->second;
+			Member cached;
+			if( vtable.cache.Find( member, cached ) )
+				return cached;
 
 			Member address = Detouring::GetVirtualAddress( vtable.pointer, vtable.size, method );
 
 			if( address.IsValid( ) )
-				vtable.cache[member] = address;
+				vtable.cache.Update( [member, address]( CacheMap &map )
+				{
+					map[member] = address;
+				} );
 
 			return address;
 		}
 
+		template<typename Definition>
+		static SecondaryVTable *GetSecondaryVirtualTable( SharedState *shared_state, Definition method, size_t &index )
+		{
+			const ptrdiff_t offset = GetSubobjectOffset( method );
+			if( offset == 0 )
+				return nullptr;
+
+			index = GetVirtualIndex( method );
+			for( SecondaryVTable &secondary : shared_state->secondary_vtables )
+				if( secondary.offset == offset )
+					return index < secondary.size ? &secondary : nullptr;
+
+			return nullptr;
+		}
+
+		static void *GetTrampoline( SharedState *shared_state, void *address )
+		{
+			void *trampoline = nullptr;
+			shared_state->trampolines.Find( address, trampoline );
+			return trampoline;
+		}
+
+		// Expects the writer mutex to be held, new trampolines go to batch when given instead of being published
+		template<
+			typename DefinitionOriginal,
+			typename DefinitionSubstitute,
+			typename TraitsOriginal = FunctionTraits<DefinitionOriginal>
+		>
+		static HookHandle<DefinitionOriginal> HookLocked(
+			SharedState *shared_state,
+			DefinitionOriginal original,
+			DefinitionSubstitute substitute,
+			TrampolineMap *batch
+		)
+		{
+			if constexpr( TraitsOriginal::IsMemberFunctionPointer )
+			{
+				size_t index = 0;
+				SecondaryVTable *secondary = GetSecondaryVirtualTable( shared_state, original, index );
+				if( secondary != nullptr )
+				{
+					HookHandle<DefinitionOriginal> handle( secondary->original[index], GetThisAdjustment( original ) );
+					if( secondary->pointer[index] != secondary->original[index] )
+						return handle;
+
+					Member subst = CacheVirtualAddress( shared_state->substitute_vtable, substitute );
+					constexpr bool returns_in_memory = Rtti::IsReturnedInMemory<typename TraitsOriginal::ReturnType>( );
+					if( !subst.IsValid( ) || !secondary->Hook( index, subst.address, returns_in_memory ) )
+						return { };
+
+					return handle;
+				}
+
+				Member target = CacheVirtualAddress( shared_state->target_vtable, original );
+				if( target.IsValid( ) )
+				{
+					HookHandle<DefinitionOriginal> handle( shared_state->original_vtable[target.index] );
+					if( shared_state->target_vtable.pointer[target.index] != shared_state->original_vtable[target.index] )
+						return handle;
+
+					Member subst = CacheVirtualAddress( shared_state->substitute_vtable, substitute );
+					if( !subst.IsValid( ) )
+						return { };
+
+					if( !WriteVirtual( shared_state, target.index, subst.address ) )
+						return { };
+
+					return handle;
+				}
+			}
+
+			void *address = GetAddress( original );
+			if( address == nullptr )
+				return { };
+
+			const auto it = shared_state->hooks.find( address );
+			if( it != shared_state->hooks.end( ) )
+				return HookHandle<DefinitionOriginal>( it->second->GetTrampoline( ), 0, address );
+
+			void *subst = GetAddress( substitute );
+			if( subst == nullptr )
+				return { };
+
+			std::unique_ptr<Detouring::Hook> &hook = shared_state->hooks[address];
+			hook.reset( new Detouring::Hook );
+			if( !hook->Create( address, subst ) )
+			{
+				shared_state->hooks.erase( address );
+				return { };
+			}
+
+			if( !hook->Enable( ) )
+			{
+				shared_state->hooks.erase( address );
+				return { };
+			}
+
+			void *trampoline = hook->GetTrampoline( );
+			if( batch != nullptr )
+				( *batch )[address] = trampoline;
+			else
+				shared_state->trampolines.Update( [address, trampoline]( TrampolineMap &map )
+				{
+					map[address] = trampoline;
+				} );
+
+			return HookHandle<DefinitionOriginal>( trampoline, 0, address );
+		}
+
+		static bool WriteVirtual( SharedState *shared_state, size_t index, void *value )
+		{
+			return WritePointer( shared_state->target_vtable.pointer + index, value );
+		}
+
 		class SharedState
 		{
 		public:
-			~SharedState( )
+			// Undoes every hook but keeps the tables, static calls that already loaded the state still read them
+			void Restore( )
 			{
+				std::lock_guard lock( writer_mutex );
+
+				trampolines.Update( []( TrampolineMap &map )
+				{
+					map.clear( );
+				} );
+				hooks.clear( );
+
+				for( SecondaryVTable &secondary : secondary_vtables )
+					secondary.Restore( );
+
 				if( target_vtable.pointer == nullptr || target_vtable.size == 0 )
 					return;
 
-				ProtectMemory( target_vtable.pointer, target_vtable.size * sizeof( void * ), false );
-
 				void **vtable = target_vtable.pointer;
-				for(
-					auto it = original_vtable.begin( );
-					it != original_vtable.end( );
-					++vtable, ++it
-				)
-					if( *vtable != *it )
-						*vtable = *it;
-
-				ProtectMemory( target_vtable.pointer, target_vtable.size * sizeof( void * ), true );
+				void *const *original = original_vtable.data( );
+				const size_t size = target_vtable.size;
+
+				std::vector<PointerPatch> patches;
+				for( size_t index = FindPointerMismatch( vtable, original, size ); index < size; )
+				{
+					patches.push_back( { vtable + index, original[index] } );
+					index += 1 + FindPointerMismatch( vtable + index + 1, original + index + 1, size - index - 1 );
+				}
+
+				if( !patches.empty( ) )
+					WritePointers( patches.data( ), patches.size( ) );
 			}
 
-			bool Initialize( Target *instance, Substitute *substitute )
+			bool Initialize( void **vtable, Target *instance, Substitute *substitute )
 			{
 				if( target_vtable.pointer != nullptr )
 					return true;
 
-				target_vtable.pointer = GetVirtualTable( instance );
+				target_vtable.pointer = vtable;
 				if( target_vtable.pointer == nullptr )
 					return false;
 
-				std::vector<void *> ovtable;
-				for( void **vtable = target_vtable.pointer; ovtable.size( ) < ovtable.max_size( ) && *vtable != nullptr; ++vtable )
-				{
-					if( !IsExecutableAddress( *vtable ) )
-						break;
-
-					ovtable.push_back( *vtable );
-				}
-
-				if( ovtable.empty( ) )
+				const size_t size = GetVirtualTableSize( target_vtable.pointer );
+				if( size == 0 )
 				{
 					target_vtable.pointer = nullptr;
 					return false;
 				}
 
-				original_vtable = std::move( ovtable );
-				target_vtable.size = original_vtable.size( );
+				original_vtable.assign( target_vtable.pointer, target_vtable.pointer + size );
+				target_vtable.size = size;
+
+				const std::vector<Rtti::VirtualTable> tables =
+					instance != nullptr ? Rtti::GetVirtualTables( instance ) : Rtti::GetVirtualTableGroup( vtable );
+				for( const Rtti::VirtualTable &table : tables )
+					if( table.offset != 0 )
+					{
+						SecondaryVTable &secondary = secondary_vtables.emplace_back( );
+						secondary.offset = table.offset;
+						secondary.pointer = table.pointer;
+						secondary.size = table.size;
+						secondary.original.assign( table.pointer, table.pointer + table.size );
+					}
 
 				substitute_vtable.pointer = GetVirtualTable( substitute );
-
-				for( ; substitute_vtable.pointer[substitute_vtable.size] != nullptr; ++substitute_vtable.size );
+				substitute_vtable.size = GetVirtualTableSize( substitute_vtable.pointer );
 
 				return true;
 			}
@@ -459,26 +1021,46 @@ namespace Detouring
 			VTable target_vtable;
 			std::vector<void *> original_vtable;
 			VTable substitute_vtable;
+			std::vector<SecondaryVTable> secondary_vtables;
+
+			// Hook and UnHook serialize on the writer mutex, the static Call and IsHooked only read published maps
+			std::mutex writer_mutex;
 			HookMap hooks;
+			PublishedMap<TrampolineMap> trampolines;
 		};
 
 		static std::shared_ptr<SharedState> GetSharedState( const bool create_if_needed = false )
 		{
-			static std::weak_ptr<SharedState> weak_shared_state;
-			static std::mutex shared_state_mutex;
-
 			std::lock_guard lock( shared_state_mutex );
 
 			auto shared_state = weak_shared_state.lock( );
 			if( !shared_state && create_if_needed )
 			{
-				shared_state = std::make_shared<SharedState>( );
+				// The state is restored with the last proxy but never freed, see GetSharedStatePointer
+				shared_state = std::shared_ptr<SharedState>( new SharedState, []( SharedState *state )
+				{
+					SharedState *expected = state;
+					shared_state_pointer.compare_exchange_strong( expected, nullptr, std::memory_order_acq_rel );
+					state->Restore( );
+				} );
 				weak_shared_state = shared_state;
+				shared_state_pointer.store( shared_state.get( ), std::memory_order_release );
 			}
 
 			return shared_state;
 		}
 
+		// Lock-free lookup for the static interface, null once the last proxy instance is gone
+		// States are leaked on purpose so a pointer loaded here stays valid while a call is in flight
+		static SharedState *GetSharedStatePointer( )
+		{
+			return shared_state_pointer.load( std::memory_order_acquire );
+		}
+
+		static inline std::weak_ptr<SharedState> weak_shared_state;
+		static inline std::mutex shared_state_mutex;
+		static inline std::atomic<SharedState *> shared_state_pointer = nullptr;
+
 		const std::shared_ptr<SharedState> state = GetSharedState( true );
 	};
 }
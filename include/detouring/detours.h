@@ -91,6 +91,7 @@
 #include "MinHook.h"
 #include "platform.hpp"
 #include "hook.hpp"
+#include "importhook.hpp"
 
 #ifdef SYSTEM_POSIX
 
@@ -572,36 +573,138 @@ namespace MologieDetours
 	*
 	* @brief Used for creating detours on an import of a single module.
 	*
-	* @deprecated This class is a dummy.
+	* @deprecated Please port all code that uses this header to the new one.
 	*/
 	template<typename function_type>
 	class DetourImport
 	{
 	public:
 		/**
-		* @fn DetourImport::DetourImport( address_type, function_type )
+		* @fn DetourImport::DetourImport( address_type pSource, function_type pDetour )
 		*
 		* @brief Creates a new local detour using a given import.
 		*
-		* @deprecated This function is a dummy.
+		* @param pSource The address of the import slot.
+		* @param pDetour The detour function.
+		*
+		* @exception DetourException Thrown when the import slot can't be redirected.
+		*
+		* @deprecated Please port all code that uses this header to the new one.
 		*/
-		DEPRECATED_WITH_SUBSTITUTE( Detouring::Hook )
-		DetourImport( uintptr_t, function_type )
-		{ }
+		DEPRECATED_WITH_SUBSTITUTE( Detouring::ImportHook )
+		DetourImport( address_type pSource, function_type pDetour )
+		{
+			if( !hook.Create(
+				reinterpret_cast<void **>( pSource ),
+				reinterpret_cast<void *>( pDetour )
+			) )
+				throw DetourException( "Invalid import slot" );
+
+			CreateDetour( );
+		}
+
+		/**
+		* @fn DetourImport::DetourImport( const char *moduleName, const char *lpProcName, function_type pDetour )
+		*
+		* @brief Creates a new local detour on an import of a module.
+		*
+		* @param moduleName The Name of the importing module.
+		* @param lpProcName Name of the imported function.
+		* @param pDetour The detour function.
+		*
+		* @exception DetourException Thrown when the import can't be found or redirected.
+		*
+		* @deprecated Please port all code that uses this header to the new one.
+		*/
+		DEPRECATED_WITH_SUBSTITUTE( Detouring::ImportHook )
+		DetourImport( const char *moduleName, const char *lpProcName, function_type pDetour )
+		{
+			if( !hook.Create( moduleName, lpProcName, reinterpret_cast<void *>( pDetour ) ) )
+				throw DetourException( "Unable to find import" );
+
+			CreateDetour( );
+		}
 
 		/**
 		* @fn bool DetourImport::IsValid( )
 		*
 		* @brief Query if the detour is still applied.
 		*
-		* @return Always returns false.
+		* @return true if the import still points to the detour, false otherwise.
 		*
-		* @deprecated This function is a dummy.
+		* @deprecated Please port all code that uses this header to the new one.
 		*/
-		DEPRECATED_WITH_SUBSTITUTE( Detouring::Hook )
+		DEPRECATED_WITH_SUBSTITUTE( Detouring::ImportHook )
 		bool IsValid( )
 		{
-			return false;
+			return hook.IsEnabled( );
+		}
+
+		/**
+		* @fn function_type DetourImport::GetSource( )
+		*
+		* @brief Gets the source.
+		*
+		* @return Returns the address of the function the import originally pointed to.
+		*
+		* @deprecated Please port all code that uses this header to the new one.
+		*/
+		DEPRECATED_WITH_SUBSTITUTE( Detouring::ImportHook )
+		function_type GetSource( )
+		{
+			return hook.template GetTarget<function_type>( );
 		}
+
+		/**
+		* @fn function_type DetourImport::GetDetour( )
+		*
+		* @brief Gets the detour.
+		*
+		* @return Returns the address of the detour.
+		*
+		* @deprecated Please port all code that uses this header to the new one.
+		*/
+		DEPRECATED_WITH_SUBSTITUTE( Detouring::ImportHook )
+		function_type GetDetour( )
+		{
+			return hook.template GetDetour<function_type>( );
+		}
+
+		/**
+		* @fn function_type DetourImport::GetOriginalFunction( )
+		*
+		* @brief Gets the original function.
+		*
+		* @return Returns a function pointer which can be used to execute the original function.
+		*
+		* @deprecated Please port all code that uses this header to the new one.
+		*/
+		DEPRECATED_WITH_SUBSTITUTE( Detouring::ImportHook )
+		function_type GetOriginalFunction( )
+		{
+			return hook.template GetTrampoline<function_type>( );
+		}
+
+	private:
+		/**
+		* @fn void DetourImport::CreateDetour( )
+		*
+		* @brief Redirects the import to the detour.
+		*
+		* @exception DetourPageProtectionException Thrown when the page protection of the import
+		* slot can not be changed.
+		*
+		* @deprecated Please port all code that uses this header to the new one.
+		*/
+		void CreateDetour( )
+		{
+			if( !hook.Enable( ) )
+				throw DetourPageProtectionException(
+					"Failed to change page protection of import slot",
+					hook.GetTarget( )
+				);
+		}
+
+		Detouring::ImportHook hook;
 	};
 }
@@ -0,0 +1,83 @@
+/*************************************************************************
+* Detouring::Disassemble
+* Shared wrapper around the HDE length disassembler.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "hde.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace Detouring
+{
+
+#if defined MOLOGIE_DETOURS_HDE_64
+
+	typedef hde64s InstructionInfo;
+
+	inline unsigned int Disassemble( const void *code, InstructionInfo &info )
+	{
+		return hde64_disasm( code, &info );
+	}
+
+#else
+
+	typedef hde32s InstructionInfo;
+
+	inline unsigned int Disassemble( const void *code, InstructionInfo &info )
+	{
+		return hde32_disasm( code, &info );
+	}
+
+#endif
+
+	// Never reads at or past end, instructions crossing it fail to decode
+	inline unsigned int Disassemble( const void *code, const void *end, InstructionInfo &info )
+	{
+		const uint8_t *start = static_cast<const uint8_t *>( code );
+		if( start >= end )
+			return 0;
+
+		const size_t available = static_cast<size_t>( static_cast<const uint8_t *>( end ) - start );
+		if( available >= 16 )
+			return Disassemble( code, info );
+
+		uint8_t buffer[16] = { };
+		std::memcpy( buffer, start, available );
+		const unsigned int length = Disassemble( buffer, info );
+		return length <= available ? length : 0;
+	}
+}
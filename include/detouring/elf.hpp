@@ -0,0 +1,154 @@
+/*************************************************************************
+* Detouring::Elf
+* C++ helpers for inspecting ELF images loaded in the current process.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "platform.hpp"
+#include "hook.hpp"
+
+#if defined SYSTEM_LINUX
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <link.h>
+
+namespace Detouring
+{
+	namespace Elf
+	{
+		struct Segment
+		{
+			uintptr_t start;
+			size_t size;
+			int32_t protection;
+		};
+
+		// Sorted for lookups by address, usually filled with the segments of every loaded image
+		class SegmentSet
+		{
+		public:
+			void Add( const Segment &segment );
+			void Sort( );
+
+			bool Contains( const void *address, size_t size = 1 ) const;
+
+		private:
+			std::vector<Segment> segments;
+		};
+
+		class Image
+		{
+		public:
+			Image( ) = default;
+			Image( const dl_phdr_info &info );
+
+			static Image FromName( const std::string &name );
+			static Image FromHandle( void *handle );
+			static Image FromAddress( const void *address );
+			static Image FromModule( const Hook::Module &module );
+
+			static std::vector<Image> GetLoaded( );
+
+			bool IsValid( ) const;
+
+			uintptr_t GetBase( ) const;
+			const std::string &GetName( ) const;
+
+			bool Contains( const void *address ) const;
+
+			std::vector<Segment> GetSegments( ) const;
+
+			// Code sections of executable segments, read from the file since section headers aren't loaded
+			std::vector<Segment> GetExecutableSections( ) const;
+
+			// Sorted addresses of defined functions, from the dynamic symbols plus the file's symbol table if it has one
+			std::vector<uintptr_t> GetFunctionStarts( ) const;
+
+			size_t GetSymbolCount( ) const;
+			const ElfW( Sym ) *GetSymbol( size_t index ) const;
+			const char *GetSymbolName( const ElfW( Sym ) *symbol ) const;
+			const ElfW( Sym ) *FindSymbol( const std::string &name ) const;
+			void *FindSymbolAddress( const std::string &name ) const;
+
+			std::vector<void **> FindImportSlots( const std::string &symbol ) const;
+
+			// Address x86 position independent code keeps in a register to reach data, 0 if unknown
+			uintptr_t GetGlobalOffsetTable( ) const;
+
+		private:
+			template<typename Relocation>
+			void FindImportSlots(
+				const Relocation *relocations,
+				size_t size,
+				const std::string &symbol,
+				std::vector<void **> &slots
+			) const;
+
+			void *ResolveIndirectFunction( const ElfW( Sym ) *symbol ) const;
+
+			size_t CountSymbols( ) const;
+			bool IsDefaultSymbol( size_t index ) const;
+			const ElfW( Sym ) *FindSymbolGnuHash( const std::string &name ) const;
+			const ElfW( Sym ) *FindSymbolSysvHash( const std::string &name ) const;
+
+			uintptr_t base = 0;
+			std::string name;
+			const ElfW( Phdr ) *headers = nullptr;
+			size_t header_count = 0;
+
+			const ElfW( Sym ) *symbols = nullptr;
+			const char *strings = nullptr;
+			const ElfW( Half ) *versions = nullptr;
+			const uint32_t *sysv_hash = nullptr;
+			const uint32_t *gnu_hash = nullptr;
+			size_t symbol_count = 0;
+			uintptr_t global_offset_table = 0;
+
+			const void *plt_relocations = nullptr;
+			size_t plt_relocations_size = 0;
+			bool plt_relocations_rela = false;
+
+			const ElfW( Rela ) *rela_relocations = nullptr;
+			size_t rela_relocations_size = 0;
+
+			const ElfW( Rel ) *rel_relocations = nullptr;
+			size_t rel_relocations_size = 0;
+		};
+	}
+}
+
+#endif
@@ -44,8 +44,10 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
 #include <type_traits>
 #include <tuple>
+#include <utility>
 
 #include "platform.hpp"
 
@@ -75,14 +77,73 @@ namespace Detouring
 		size_t index;
 	};
 
+	struct PointerPatch
+	{
+		void **slot;
+		void *value;
+	};
+
+	uintptr_t GetPageSize( );
+
 	int32_t GetMemoryProtection( void *address );
 
+	// Protection shared by every page in the range, Error if any page differs
+	int32_t GetMemoryProtection( void *address, size_t length );
+
 	bool SetMemoryProtection( void *address, size_t length, int32_t protection );
 
 	bool ProtectMemory( void *address, size_t length, bool protect );
 
 	bool IsExecutableAddress( void *address );
 
+	// Index of the first pointer equal to value, count if there's none
+	size_t FindPointer( void *const *pointers, size_t count, const void *value );
+
+	// Index of the first position where the arrays differ, count if they're equal
+	size_t FindPointerMismatch( void *const *first, void *const *second, size_t count );
+
+	// Exact when the virtual table symbol is exported, otherwise stops at the first non executable entry
+	size_t GetVirtualTableSize( void **vtable );
+
+	// Virtual table headers only hold small offsets besides the type info, never mapped addresses
+	bool IsVirtualTableOffset( const void *entry );
+
+	// Entries before the address point, up to the start of the _ZTV symbol when it's exported
+	size_t GetVirtualTablePrefixSize( void **vtable );
+
+	// Lazily bound PLT slots point to the stub that pushes the relocation index until the first call
+	bool IsLazyBindingStub( const void *code );
+
+	// Follows jump thunks and PLT/IAT stubs until reaching the function body
+	void *FollowJumps( void *address );
+
+	// Writes every pointer, changing protections once per run of contiguous pages
+	bool WritePointers( const PointerPatch *patches, size_t count );
+
+	// Same as WritePointers for a single slot, the page gets back its exact protection
+	bool WritePointer( void **slot, void *value );
+
+	// Release store, threads dispatching through the slot never see a torn pointer
+	void StorePointer( void **slot, void *value );
+
+	// Returns the previous value, or nullptr if the slot isn't pointer aligned
+	void *ExchangePointer( void **slot, void *value );
+
+	// On failure expected receives the value found in the slot
+	bool CompareExchangePointer( void **slot, void *&expected, void *desired );
+
+	// Allocates readable, writable and executable memory, within 2GB of the nearby address if possible
+	void *AllocateExecutableMemory( size_t size, void *nearby = nullptr );
+
+	bool FreeExecutableMemory( void *address, size_t size );
+
+	// Carves small blocks out of shared executable chunks instead of giving each one its own pages
+	// Chunks are mapped RWX for the lifetime of the process since blocks are written after allocation
+	void *AllocateExecutableBlock( size_t size, void *nearby = nullptr );
+
+	// The size must match the one used to allocate the block
+	bool FreeExecutableBlock( void *address, size_t size );
+
 	template<typename Class>
 	inline void **GetVirtualTable( Class *instance )
 	{
@@ -207,12 +268,82 @@ namespace Detouring
 		if( magic.offset <= 0xFFFF )
 			return address;
 
-		// Check whether the function starts with a relative far jump and assume a debug compilation thunk
-		uint8_t *method_code = reinterpret_cast<uint8_t *>( address );
-		if( method_code[0] == 0xE9 )
-			address = method_code + 5 + *reinterpret_cast<int32_t *>( method_code + 1 );
+		// Skip debug compilation and incremental linking thunks
+		return FollowJumps( address );
+	}
 
-		return address;
+	template<
+		typename Definition,
+		typename Traits = FunctionTraits<Definition>,
+		std::enable_if_t<!Traits::IsMemberFunctionPointer, int> = 0
+	>
+	inline void *GetAddress( Definition function )
+	{
+		return reinterpret_cast<void *>( function );
+	}
+
+	// Only the Itanium ABI encodes the virtual table slot in member function pointers
+	template<
+		typename Definition,
+		typename Traits = FunctionTraits<Definition>,
+		std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+	>
+	inline size_t GetVirtualIndex( Definition method )
+	{
+
+#ifdef COMPILER_VC
+
+		(void)method;
+		return static_cast<size_t>( ~0 );
+
+#else
+
+		MemberToAddress<Definition> magic;
+		magic.member = method;
+		if( ( magic.offset & 1 ) == 0 )
+			return static_cast<size_t>( ~0 );
+
+		return ( magic.offset - 1 ) / sizeof( void * );
+
+#endif
+
+	}
+
+	// The Itanium ABI stores the this adjustment after the function pointer or virtual table offset
+	template<
+		typename Definition,
+		typename Traits = FunctionTraits<Definition>,
+		std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+	>
+	inline ptrdiff_t GetThisAdjustment( Definition method )
+	{
+
+#ifdef COMPILER_VC
+
+		(void)method;
+		return 0;
+
+#else
+
+		struct
+		{
+			uintptr_t pointer;
+			ptrdiff_t adjustment;
+		} layout;
+		static_assert( sizeof( layout ) == sizeof( method ), "unexpected member function pointer layout" );
+		std::memcpy( &layout, &method, sizeof( layout ) );
+		return layout.adjustment;
+
+#endif
+
+	}
+
+	// Member function pointers can't be inspected in constant expressions, so decode them once per method
+	template<auto Method>
+	inline size_t GetVirtualIndex( )
+	{
+		static const size_t index = GetVirtualIndex( Method );
+		return index;
 	}
 
 	// Can be used with interfaces and implementations
@@ -261,9 +392,9 @@ namespace Detouring
 			return Member( index, vtable[index] );
 		}
 
-		for( size_t index = 0; index < size; ++index )
-			if( vtable[index] == member )
-				return Member( index, member );
+		const size_t index = FindPointer( vtable, size, member );
+		if( index < size )
+			return Member( index, member );
 
 		return Member( );
 
@@ -276,9 +407,9 @@ namespace Detouring
 
 		if( offset >= size )
 		{
-			for( size_t index = 0; index < size; ++index )
-				if( vtable[index] == address )
-					return Member( index, address );
+			const size_t index = FindPointer( vtable, size, address );
+			if( index < size )
+				return Member( index, address );
 
 			return Member( );
 		}
@@ -288,4 +419,53 @@ namespace Detouring
 #endif
 
 	}
+
+	template<typename ReturnType, typename... Parameters, typename... Args>
+	inline ReturnType CallFunctionAddress( std::tuple<Parameters...>, void *address, void *object, Args &&... args )
+	{
+		return reinterpret_cast<ReturnType ( * )( void *, Parameters... )>( address )(
+			object,
+			std::forward<Args>( args )...
+		);
+	}
+
+	// Calls address as the method Definition describes, with adjustment added to this like a member function pointer would
+	template<
+		typename Definition,
+		typename Class,
+		typename... Args,
+		typename Traits = FunctionTraits<Definition>,
+		typename ReturnType = typename Traits::ReturnType,
+		std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+	>
+	inline ReturnType CallMemberAddress( Class *instance, void *address, ptrdiff_t adjustment, Args &&... args )
+	{
+
+#ifndef COMPILER_VC
+
+		// Odd addresses read as virtual table offsets in member function pointers,
+		// call them as functions taking this first, which is what the Itanium ABI does anyway
+		if( ( reinterpret_cast<uintptr_t>( address ) & 1 ) != 0 )
+		{
+			typedef typename Traits::TargetClass TargetClass;
+			void *object = reinterpret_cast<uint8_t *>( static_cast<TargetClass *>( instance ) ) + adjustment;
+			return CallFunctionAddress<ReturnType>(
+				typename Traits::ArgTypes( ),
+				address,
+				object,
+				std::forward<Args>( args )...
+			);
+		}
+
+#endif
+
+		struct CallMagic
+		{
+			const void *address = nullptr;
+			const ptrdiff_t offset = 0;
+			const size_t unused[2] = { 0, 0 };
+		} func = { address, adjustment };
+		auto typedfunc = reinterpret_cast<Definition *>( &func );
+		return ( instance->**typedfunc )( std::forward<Args>( args )... );
+	}
 }
@@ -35,6 +35,9 @@
 
 #pragma once
 
+#include "callprofiler.hpp"
+
+#include <cstdint>
 #include <string>
 
 namespace Detouring
@@ -125,12 +128,33 @@ namespace Detouring
 			return reinterpret_cast<Method>( GetTrampoline( ) );
 		}
 
+		struct Profile
+		{
+			uint64_t calls;
+			uint64_t cycles;
+		};
+
+		// Takes effect on the next Create, the detour is then reached through a CallProfiler stub
+		// Only calls are counted unless cycles are asked for, which CallProfiler may not support
+		bool EnableProfiling( bool measure_cycles = false );
+		bool DisableProfiling( );
+
+		Profile GetProfile( ) const;
+
+		void ResetProfile( );
+
 	private:
 		void *FindSymbol( const std::string &symbol );
 		void *FindSymbol( void *module, const std::string &symbol );
 
+		// The detour itself, or the profiling stub leading to it
+		void *GetEntry( void *detour, void *nearby );
+
 		void *target = nullptr;
 		void *detour = nullptr;
 		void *trampoline = nullptr;
+		bool profiling = false;
+		bool profile_cycles = false;
+		CallProfiler profiler;
 	};
 }
@@ -0,0 +1,194 @@
+/*************************************************************************
+* Detouring::ImportHook
+* A C++ class that allows you to redirect the imports of a module.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "hook.hpp"
+#include "helpers.hpp"
+#include "platform.hpp"
+#include "elf.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Detouring
+{
+	class ImportHook
+	{
+	public:
+		ImportHook( ) = default;
+		ImportHook( void **slot, void *detour );
+		ImportHook( const Hook::Module &module, const std::string &target, void *detour );
+
+		ImportHook( const ImportHook & ) = delete;
+		ImportHook( ImportHook && ) = delete;
+
+		~ImportHook( );
+
+		ImportHook &operator=( const ImportHook & ) = delete;
+		ImportHook &operator=( ImportHook && ) = delete;
+
+		bool IsValid( ) const;
+
+		bool Create( void **slot, void *detour );
+		bool Create( const Hook::Module &module, const std::string &target, void *detour );
+		bool Destroy( );
+
+		bool IsEnabled( ) const;
+		bool Enable( );
+		bool Disable( );
+
+		void *GetTarget( ) const;
+
+		template<typename Method>
+		Method GetTarget( ) const
+		{
+			return reinterpret_cast<Method>( GetTarget( ) );
+		}
+
+		void *GetDetour( ) const;
+
+		template<typename Method>
+		Method GetDetour( ) const
+		{
+			return reinterpret_cast<Method>( GetDetour( ) );
+		}
+
+		// Nothing is relocated, the original import is callable as is
+		void *GetTrampoline( ) const;
+
+		template<typename Method>
+		Method GetTrampoline( ) const
+		{
+			return reinterpret_cast<Method>( GetTrampoline( ) );
+		}
+
+	private:
+		struct Slot
+		{
+			void **address;
+			void *original;
+		};
+
+		std::vector<Slot> slots;
+		void *target = nullptr;
+		void *detour = nullptr;
+	};
+
+	// Redirects an import on every loaded module, modules loaded later are picked up by Refresh
+	// dlopen isn't interposed, that would make the loader resolve $ORIGIN and RPATH against this library
+	class GlobalImportHook
+	{
+	public:
+		GlobalImportHook( ) = default;
+		GlobalImportHook( const std::string &target, void *detour );
+
+		GlobalImportHook( const GlobalImportHook & ) = delete;
+		GlobalImportHook( GlobalImportHook && ) = delete;
+
+		~GlobalImportHook( );
+
+		GlobalImportHook &operator=( const GlobalImportHook & ) = delete;
+		GlobalImportHook &operator=( GlobalImportHook && ) = delete;
+
+		bool IsValid( ) const;
+
+		bool Create( const std::string &target, void *detour );
+		bool Destroy( );
+
+		bool IsEnabled( ) const;
+		bool Enable( );
+		bool Disable( );
+
+		void *GetTarget( ) const;
+
+		template<typename Method>
+		Method GetTarget( ) const
+		{
+			return reinterpret_cast<Method>( GetTarget( ) );
+		}
+
+		void *GetDetour( ) const;
+
+		template<typename Method>
+		Method GetDetour( ) const
+		{
+			return reinterpret_cast<Method>( GetDetour( ) );
+		}
+
+		// Nothing is relocated, the original import is callable as is
+		void *GetTrampoline( ) const;
+
+		template<typename Method>
+		Method GetTrampoline( ) const
+		{
+			return reinterpret_cast<Method>( GetTrampoline( ) );
+		}
+
+		// Redirects the imports of modules loaded since the last refresh,
+		// cheap enough to call often since it returns early when no module was loaded or unloaded
+		static void Refresh( );
+
+	private:
+		struct Slot
+		{
+			void **address;
+			void *original;
+		};
+
+		struct Module
+		{
+			uintptr_t base;
+			std::string name;
+			std::vector<Slot> slots;
+		};
+
+#if defined SYSTEM_LINUX
+
+		static void Patch( const std::vector<Elf::Image> &images );
+
+		void Collect( const Elf::Image &image, std::vector<PointerPatch> &patches );
+		bool Restore( );
+
+#endif
+
+		std::string target_name;
+		void *target = nullptr;
+		void *detour = nullptr;
+		bool enabled = false;
+		std::vector<Module> modules;
+	};
+}
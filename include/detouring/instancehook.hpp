@@ -0,0 +1,120 @@
+/*************************************************************************
+* Detouring::InstanceHook
+* Virtual table hooks scoped to single objects.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "helpers.hpp"
+#include "platform.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace Detouring
+{
+	// Points one object at a library owned copy of its virtual table, other objects keep the original dispatch
+	// Disable, Destroy and the destructor write the object's virtual table pointer back,
+	// so the object must outlive the hook or the hook must be destroyed first
+	class InstanceHook
+	{
+	public:
+		InstanceHook( ) = default;
+		InstanceHook( void *instance );
+
+		InstanceHook( const InstanceHook & ) = delete;
+		InstanceHook( InstanceHook && ) = delete;
+
+		~InstanceHook( );
+
+		InstanceHook &operator=( const InstanceHook & ) = delete;
+		InstanceHook &operator=( InstanceHook && ) = delete;
+
+		bool IsValid( ) const;
+
+		bool Create( void *instance );
+		bool Destroy( );
+
+		bool IsEnabled( ) const;
+		bool Enable( );
+		bool Disable( );
+
+		bool HookVirtual( size_t index, void *detour );
+
+		template<
+			typename Definition,
+			typename Traits = FunctionTraits<Definition>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		bool HookVirtual( Definition method, void *detour )
+		{
+			const Member member = GetVirtualAddress( original_vtable, size, method );
+			return member.IsValid( ) && HookVirtual( member.index, detour );
+		}
+
+		bool UnHookVirtual( size_t index );
+
+		template<
+			typename Definition,
+			typename Traits = FunctionTraits<Definition>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		bool UnHookVirtual( Definition method )
+		{
+			const Member member = GetVirtualAddress( original_vtable, size, method );
+			return member.IsValid( ) && UnHookVirtual( member.index );
+		}
+
+		bool IsHooked( size_t index ) const;
+
+		void *GetInstance( ) const;
+
+		size_t GetSize( ) const;
+
+		void *GetOriginal( size_t index ) const;
+
+		template<typename Method>
+		Method GetOriginal( size_t index ) const
+		{
+			return reinterpret_cast<Method>( GetOriginal( index ) );
+		}
+
+	private:
+		void *instance = nullptr;
+		void **original_vtable = nullptr;
+		size_t size = 0;
+		size_t header_size = 0;
+		std::vector<void *> shadow_vtable;
+	};
+}
@@ -0,0 +1,102 @@
+/*************************************************************************
+* Detouring::InterfaceIndex
+* Indexes CreateInterface registrations by name and version.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "hook.hpp"
+#include "platform.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Detouring
+{
+	// Walks the InterfaceReg list behind CreateInterface once per module, lookups are hash map hits afterwards
+	class InterfaceIndex
+	{
+	public:
+		typedef void *( *Factory )( );
+
+		InterfaceIndex( ) = default;
+		InterfaceIndex( const Hook::Module &module );
+
+		InterfaceIndex( const InterfaceIndex & ) = delete;
+		InterfaceIndex( InterfaceIndex && ) = delete;
+
+		InterfaceIndex &operator=( const InterfaceIndex & ) = delete;
+		InterfaceIndex &operator=( InterfaceIndex && ) = delete;
+
+		bool IsValid( ) const;
+
+		// Can be called once per module, the first module registering a name wins like with CreateInterface
+		bool Create( const Hook::Module &module );
+		bool Destroy( );
+
+		size_t GetInterfaceCount( ) const;
+
+		std::vector<std::string> GetInterfaceNames( ) const;
+
+		Factory FindFactory( const std::string &name ) const;
+
+		// Calls the factory, single interfaces hand back the same object every time
+		void *CreateInterface( const std::string &name ) const;
+
+		template<typename Interface>
+		Interface *CreateInterface( const std::string &name ) const
+		{
+			return static_cast<Interface *>( CreateInterface( name ) );
+		}
+
+		// Highest registered version of a name without its trailing digits, like VEngineServer for VEngineServer023
+		const std::string *FindLatestVersion( const std::string &base ) const;
+
+	private:
+		struct Registration
+		{
+			Factory factory;
+			const char *name;
+			Registration *next;
+		};
+
+		static Registration *FindRegistrations( const Hook::Module &module );
+
+		std::vector<Registration *> lists;
+		std::unordered_map<std::string, Factory> factories;
+		std::unordered_map<std::string, std::string> latest_versions;
+	};
+}
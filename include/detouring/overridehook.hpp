@@ -0,0 +1,130 @@
+/*************************************************************************
+* Detouring::VirtualOverrideHook
+* Redirects a virtual slot in a class and every class derived from it.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "helpers.hpp"
+#include "pointermap.hpp"
+#include "vtableindex.hpp"
+#include "platform.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace Detouring
+{
+	// The detour is shared by every class, it finds the implementation it replaced through the instance
+	class VirtualOverrideHook
+	{
+	public:
+		VirtualOverrideHook( ) = default;
+		VirtualOverrideHook( const VirtualTableIndex &index, void **vtable, size_t slot, void *detour );
+
+		template<
+			typename Definition,
+			typename Traits = FunctionTraits<Definition>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		VirtualOverrideHook( const VirtualTableIndex &index, void **vtable, Definition method, void *detour )
+		{
+			Create( index, vtable, method, detour );
+		}
+
+		VirtualOverrideHook( const VirtualOverrideHook & ) = delete;
+		VirtualOverrideHook( VirtualOverrideHook && ) = delete;
+
+		~VirtualOverrideHook( );
+
+		VirtualOverrideHook &operator=( const VirtualOverrideHook & ) = delete;
+		VirtualOverrideHook &operator=( VirtualOverrideHook && ) = delete;
+
+		bool IsValid( ) const;
+
+		// vtable is the primary table of the base class, derived classes come from the index
+		bool Create( const VirtualTableIndex &index, void **vtable, size_t slot, void *detour );
+
+		template<
+			typename Definition,
+			typename Traits = FunctionTraits<Definition>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		bool Create( const VirtualTableIndex &index, void **vtable, Definition method, void *detour )
+		{
+			const size_t slot = GetVirtualIndex( method );
+			return slot != static_cast<size_t>( ~0 ) && Create( index, vtable, slot, detour );
+		}
+
+		bool Destroy( );
+
+		bool IsEnabled( ) const;
+		bool Enable( );
+		bool Disable( );
+
+		size_t GetSlotCount( ) const;
+
+		void *GetDetour( ) const;
+
+		// Implementation the table held before being patched
+		void *GetOriginal( void **vtable ) const;
+
+		template<typename Method>
+		Method GetOriginal( void **vtable ) const
+		{
+			return reinterpret_cast<Method>( GetOriginal( vtable ) );
+		}
+
+		// Safe to call from the detour while other threads enable or disable the hook
+		// Instances of classes missing from the index get the original of the base class
+		void *GetOriginal( const void *instance ) const;
+
+		template<typename Method>
+		Method GetOriginal( const void *instance ) const
+		{
+			return reinterpret_cast<Method>( GetOriginal( instance ) );
+		}
+
+	private:
+		struct Slot
+		{
+			void **address;
+			void *original;
+		};
+
+		std::vector<Slot> slots;
+		PointerMap<void *> originals;
+		void *detour = nullptr;
+	};
+}
@@ -0,0 +1,228 @@
+/*************************************************************************
+* Detouring::PointerMap
+* Flat hash map specialized for pointer keys.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+namespace Detouring
+{
+	// Entries are stored contiguously and scanned linearly while the map is small,
+	// larger maps add a linear probing index over them
+	template<typename Value>
+	class PointerMap
+	{
+	public:
+		typedef std::pair<void *, Value> value_type;
+		typedef typename std::vector<value_type>::iterator iterator;
+		typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+		iterator begin( )
+		{
+			return entries.begin( );
+		}
+
+		const_iterator begin( ) const
+		{
+			return entries.begin( );
+		}
+
+		iterator end( )
+		{
+			return entries.end( );
+		}
+
+		const_iterator end( ) const
+		{
+			return entries.end( );
+		}
+
+		size_t size( ) const
+		{
+			return entries.size( );
+		}
+
+		bool empty( ) const
+		{
+			return entries.empty( );
+		}
+
+		iterator find( const void *key )
+		{
+			return entries.begin( ) + static_cast<ptrdiff_t>( Find( key ) );
+		}
+
+		const_iterator find( const void *key ) const
+		{
+			return entries.begin( ) + static_cast<ptrdiff_t>( Find( key ) );
+		}
+
+		Value &operator[]( void *key )
+		{
+			const size_t position = Find( key );
+			if( position != entries.size( ) )
+				return entries[position].second;
+
+			entries.emplace_back( key, Value( ) );
+			if( !slots.empty( ) && entries.size( ) * 2 <= slots.size( ) )
+				Insert( entries.size( ) - 1 );
+			else if( entries.size( ) > linear_limit )
+				Rehash( );
+
+			return entries.back( ).second;
+		}
+
+		iterator erase( const_iterator it )
+		{
+			const size_t position = static_cast<size_t>( it - entries.cbegin( ) );
+			const size_t last = entries.size( ) - 1;
+			if( !slots.empty( ) )
+			{
+				Remove( FindSlot( entries[position].first ) );
+
+				// The last entry takes the place of the removed one
+				if( position != last )
+					slots[FindSlot( entries[last].first )] = static_cast<uint32_t>( position + 1 );
+			}
+
+			if( position != last )
+				entries[position] = std::move( entries[last] );
+
+			entries.pop_back( );
+			return entries.begin( ) + static_cast<ptrdiff_t>( position );
+		}
+
+		size_t erase( const void *key )
+		{
+			const size_t position = Find( key );
+			if( position == entries.size( ) )
+				return 0;
+
+			erase( entries.cbegin( ) + static_cast<ptrdiff_t>( position ) );
+			return 1;
+		}
+
+		void clear( )
+		{
+			entries.clear( );
+			slots.clear( );
+		}
+
+	private:
+		static constexpr size_t linear_limit = 32;
+
+		// Fibonacci hashing, the low bits of pointers are mostly alignment
+		size_t GetHome( const void *key ) const
+		{
+			const uint64_t value = static_cast<uint64_t>( reinterpret_cast<uintptr_t>( key ) );
+			return static_cast<size_t>( ( value * 0x9E3779B97F4A7C15ULL ) >> ( 64 - bits ) );
+		}
+
+		size_t Find( const void *key ) const
+		{
+			if( slots.empty( ) )
+			{
+				for( size_t k = 0; k < entries.size( ); ++k )
+					if( entries[k].first == key )
+						return k;
+
+				return entries.size( );
+			}
+
+			const size_t mask = slots.size( ) - 1;
+			for( size_t slot = GetHome( key ); slots[slot] != 0; slot = ( slot + 1 ) & mask )
+				if( entries[slots[slot] - 1].first == key )
+					return slots[slot] - 1;
+
+			return entries.size( );
+		}
+
+		// Only called for keys that are present
+		size_t FindSlot( const void *key ) const
+		{
+			const size_t mask = slots.size( ) - 1;
+			size_t slot = GetHome( key );
+			while( entries[slots[slot] - 1].first != key )
+				slot = ( slot + 1 ) & mask;
+
+			return slot;
+		}
+
+		void Insert( size_t position )
+		{
+			const size_t mask = slots.size( ) - 1;
+			size_t slot = GetHome( entries[position].first );
+			while( slots[slot] != 0 )
+				slot = ( slot + 1 ) & mask;
+
+			slots[slot] = static_cast<uint32_t>( position + 1 );
+		}
+
+		// Backward shift deletion, keeps probe sequences intact without tombstones
+		void Remove( size_t slot )
+		{
+			const size_t mask = slots.size( ) - 1;
+			for( size_t next = ( slot + 1 ) & mask; slots[next] != 0; next = ( next + 1 ) & mask )
+			{
+				const size_t home = GetHome( entries[slots[next] - 1].first );
+				if( ( ( next - home ) & mask ) >= ( ( next - slot ) & mask ) )
+				{
+					slots[slot] = slots[next];
+					slot = next;
+				}
+			}
+
+			slots[slot] = 0;
+		}
+
+		void Rehash( )
+		{
+			bits = 6;
+			while( ( static_cast<size_t>( 1 ) << bits ) < entries.size( ) * 2 )
+				++bits;
+
+			slots.assign( static_cast<size_t>( 1 ) << bits, 0 );
+			for( size_t k = 0; k < entries.size( ); ++k )
+				Insert( k );
+		}
+
+		std::vector<value_type> entries;
+		std::vector<uint32_t> slots;
+		size_t bits = 0;
+	};
+}
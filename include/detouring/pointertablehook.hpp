@@ -0,0 +1,115 @@
+/*************************************************************************
+* Detouring::PointerTableHook
+* Batched hooks over arrays of function pointers.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "helpers.hpp"
+#include "platform.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+namespace Detouring
+{
+	// Replaces entries of a function pointer table, like callback arrays, interface factories or luaL_Reg lists
+	class PointerTableHook
+	{
+	public:
+		struct Slot
+		{
+			size_t index;
+			void *replacement;
+		};
+
+		PointerTableHook( ) = default;
+		PointerTableHook( void *table, size_t count, size_t stride = sizeof( void * ) );
+
+		PointerTableHook( const PointerTableHook & ) = delete;
+		PointerTableHook( PointerTableHook && ) = delete;
+
+		~PointerTableHook( );
+
+		PointerTableHook &operator=( const PointerTableHook & ) = delete;
+		PointerTableHook &operator=( PointerTableHook && ) = delete;
+
+		bool IsValid( ) const;
+
+		// Table points at the first function pointer, entries are stride bytes apart (for luaL_Reg, &regs[0].func and sizeof( luaL_Reg ))
+		bool Create( void *table, size_t count, size_t stride = sizeof( void * ) );
+		bool Destroy( );
+
+		bool Hook( size_t index, void *replacement );
+
+		// All slots are written with a single protection change per run of pages
+		bool Hook( std::initializer_list<Slot> slots );
+
+		bool UnHook( size_t index );
+		bool UnHook( std::initializer_list<size_t> indices );
+		bool UnHookAll( );
+
+		bool IsHooked( size_t index ) const;
+
+		// Index of the entry whose original value is function, GetSize if there's none
+		size_t FindIndex( const void *function ) const;
+
+		void **GetSlot( size_t index ) const;
+
+		size_t GetSize( ) const;
+
+		void *GetOriginal( size_t index ) const;
+
+		template<typename Function>
+		Function GetOriginal( size_t index ) const
+		{
+			return reinterpret_cast<Function>( GetOriginal( index ) );
+		}
+
+		template<typename Function, typename... Args>
+		auto CallOriginal( size_t index, Args &&... args ) const
+		{
+			return GetOriginal<Function>( index )( std::forward<Args>( args )... );
+		}
+
+	protected:
+		uint8_t *table = nullptr;
+		size_t size = 0;
+		size_t stride = sizeof( void * );
+		std::vector<void *> originals;
+		std::vector<void *> replacements;
+	};
+}
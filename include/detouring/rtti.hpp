@@ -0,0 +1,100 @@
+/*************************************************************************
+* Detouring::Rtti
+* Virtual table group discovery for the Itanium C++ ABI.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "platform.hpp"
+#include "hook.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Detouring
+{
+	namespace Rtti
+	{
+		struct VirtualTable
+		{
+			// Distance from the instance to the subobject whose virtual table pointer holds this table
+			ptrdiff_t offset;
+			void **pointer;
+			size_t size;
+		};
+
+		// The primary table comes first, followed by the secondary tables of the base subobjects
+		// Only the primary table is returned for the Microsoft ABI, outside Linux or for classes built without RTTI
+		std::vector<VirtualTable> GetVirtualTables( void *instance );
+
+		// Same as above for a primary table found without an instance, secondary tables can't be verified against one
+		std::vector<VirtualTable> GetVirtualTableGroup( void **vtable );
+
+		// Finds the primary virtual table of a class by its mangled name (as in _ZTV<name>, e.g. "N4Game6PlayerE"),
+		// through the exported symbol or the type info name string, only on Linux
+		void **FindVirtualTable( const Hook::Module &module, const std::string &name );
+
+		// Bytes reserved for each thunk written by WriteThisAdjustingThunk
+		static constexpr size_t thunk_size = 32;
+
+#if defined ARCHITECTURE_X86_64
+
+		// System V returns trivially copyable classes of up to two eightbytes in registers, i386 never does
+		static constexpr size_t register_return_size = 16;
+
+#else
+
+		static constexpr size_t register_return_size = 0;
+
+#endif
+
+		// Whether a method returning Type gets a hidden result pointer, which the Itanium ABI passes ahead of this
+		template<typename Type>
+		constexpr bool IsReturnedInMemory( )
+		{
+			if constexpr( !std::is_class_v<Type> && !std::is_union_v<Type> )
+				return false;
+			else if constexpr( !std::is_trivially_copy_constructible_v<Type> || !std::is_trivially_destructible_v<Type> )
+				return true;
+			else
+				return sizeof( Type ) > register_return_size;
+		}
+
+		// Writes code that moves this from a subobject back to the instance and jumps to the target
+		// The Microsoft ABI keeps this first either way, so returns_in_memory only matters elsewhere
+		bool WriteThisAdjustingThunk( void *code, ptrdiff_t offset, void *target, bool returns_in_memory = false );
+	}
+}
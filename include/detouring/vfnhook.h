@@ -49,6 +49,8 @@ void main( )
 }
 */
 
+// Detouring::VTableHook in vtablehook.hpp keeps the originals itself and hooks many slots at once
+
 #include <stdint.h>
 #include "helpers.hpp"
 #include "platform.hpp"
@@ -75,33 +77,46 @@ class CVirtualCallGate
 public:
 	CVirtualCallGate( )
 	{
-		Detouring::ProtectMemory( m_szGate, sizeof( m_szGate ), false );
+		m_pGate = static_cast<uint8_t *>( Detouring::AllocateExecutableBlock( sizeof( szGateTemplate ) ) );
 	}
 
-	void Build( void *pOrigFunc, void *pNewFunc, void *pOrgFuncCaller )
+	~CVirtualCallGate( )
+	{
+		Detouring::FreeExecutableBlock( m_pGate, sizeof( szGateTemplate ) );
+	}
+
+	CVirtualCallGate( const CVirtualCallGate & ) = delete;
+	CVirtualCallGate &operator=( const CVirtualCallGate & ) = delete;
+
+	bool Build( void *pOrigFunc, void *pNewFunc, void *pOrgFuncCaller )
 	{
-		static uint8_t szGate[] = {
-			//pop a	push c	push a	mov a, <dword>	jmp a
-			0x58,	0x51,	0x50,	0xB8, 0,0,0,0,	0xFF, 0xE0,
-			//pop a	pop c	push a	mov a, <dword>	jmp a
-			0x58,	0x59,	0x50,	0xB8, 0,0,0,0,	0xFF, 0xE0
-		};
+		if( m_pGate == nullptr )
+			return false;
 
-		memcpy( m_szGate, &szGate, sizeof( szGate ) );
+		memcpy( m_pGate, szGateTemplate, sizeof( szGateTemplate ) );
 
-		*(uintptr_t *)&m_szGate[4] = (uintptr_t)pNewFunc;
-		*(uintptr_t *)&m_szGate[14] = (uintptr_t)pOrigFunc;
+		*(uintptr_t *)&m_pGate[4] = (uintptr_t)pNewFunc;
+		*(uintptr_t *)&m_pGate[14] = (uintptr_t)pOrigFunc;
 			
-		*(uintptr_t *)pOrgFuncCaller = (uintptr_t)&m_szGate[10];
+		*(uintptr_t *)pOrgFuncCaller = (uintptr_t)&m_pGate[10];
+		return true;
 	}
 
 	uintptr_t Gate( )
 	{
-		return (uintptr_t)&m_szGate[0];
+		return (uintptr_t)&m_pGate[0];
 	}
 
 private:
-	uint8_t m_szGate[20];
+	static constexpr uint8_t szGateTemplate[] = {
+		//pop a	push c	push a	mov a, <dword>	jmp a
+		0x58,	0x51,	0x50,	0xB8, 0,0,0,0,	0xFF, 0xE0,
+		//pop a	pop c	push a	mov a, <dword>	jmp a
+		0x58,	0x59,	0x50,	0xB8, 0,0,0,0,	0xFF, 0xE0
+	};
+
+	// Packed with other gates in a shared executable pool instead of the object's own page
+	uint8_t *m_pGate;
 };
 
 #define VFUNC __stdcall
@@ -112,16 +127,12 @@ private:
 	CVirtualCallGate funcname##Gate
 	
 #define HOOKVFUNC( classptr, index, funcname, newfunc ) \
-	Detouring::ProtectMemory( (void *)VTBL( classptr ), ( index + 1 ) * sizeof( void * ), false ); \
 	funcname##Raw_Org = (void *)VFN( classptr, index ); \
-	funcname##Gate.Build( funcname##Raw_Org, newfunc, &funcname ); \
-	*(uintptr_t *)PVFN( classptr, index ) = funcname##Gate.Gate( ); \
-	Detouring::ProtectMemory( (void *)VTBL( classptr ), ( index + 1 ) * sizeof( void * ), true )
+	if( funcname##Gate.Build( funcname##Raw_Org, newfunc, &funcname ) ) \
+		Detouring::WritePointer( (void **)PVFN( classptr, index ), (void *)funcname##Gate.Gate( ) )
 
 #define UNHOOKVFUNC( classptr, index, funcname ) \
-	Detouring::ProtectMemory( (void *)VTBL( classptr ), ( index + 1 ) * sizeof( void * ), false ); \
-	*(uintptr_t *)PVFN( classptr, index ) = (uintptr_t)funcname##Raw_Org; \
-	Detouring::ProtectMemory( (void *)VTBL( classptr ), ( index + 1 ) * sizeof( void * ), true )
+	Detouring::WritePointer( (void **)PVFN( classptr, index ), funcname##Raw_Org )
 
 #elif defined SYSTEM_POSIX
 
@@ -131,15 +142,11 @@ private:
 	funcname##Func funcname = nullptr
 
 #define HOOKVFUNC( classptr, index, funcname, newfunc ) \
-	Detouring::ProtectMemory( (void *)VTBL( classptr ), ( index + 1 ) * sizeof( void * ), false ); \
 	funcname = (funcname##Func)VFN( classptr, index ); \
-	*(uintptr_t *)PVFN( classptr, index ) = (uintptr_t)newfunc; \
-	Detouring::ProtectMemory( (void *)VTBL( classptr ), ( index + 1 ) * sizeof( void * ), true )
+	Detouring::WritePointer( (void **)PVFN( classptr, index ), (void *)newfunc )
 
 #define UNHOOKVFUNC( classptr, index, funcname  ) \
-	Detouring::ProtectMemory( (void *)VTBL( classptr ), ( index + 1 ) * sizeof( void * ), false ); \
-	*(uintptr_t *)PVFN( classptr, index ) = (uintptr_t)funcname; \
-	Detouring::ProtectMemory( (void *)VTBL( classptr ), ( index + 1 ) * sizeof( void * ), true )
+	Detouring::WritePointer( (void **)PVFN( classptr, index ), (void *)funcname )
 
 #endif
 
@@ -0,0 +1,135 @@
+/*************************************************************************
+* Detouring::VTableHook
+* Batched virtual table slot hooks with typed calls to the originals.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "pointertablehook.hpp"
+#include "helpers.hpp"
+#include "platform.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace Detouring
+{
+	// Replaces slots of a shared virtual table, a typed alternative to the vfnhook.h macros
+	class VTableHook : public PointerTableHook
+	{
+	public:
+		VTableHook( ) = default;
+		VTableHook( void **vtable, size_t size = 0 );
+
+		VTableHook( const VTableHook & ) = delete;
+		VTableHook( VTableHook && ) = delete;
+
+		VTableHook &operator=( const VTableHook & ) = delete;
+		VTableHook &operator=( VTableHook && ) = delete;
+
+		// A size of 0 uses GetVirtualTableSize
+		bool Create( void **vtable, size_t size = 0 );
+
+		template<typename Class>
+		bool Create( Class *instance )
+		{
+			return instance != nullptr && Create( Detouring::GetVirtualTable( instance ) );
+		}
+
+		using PointerTableHook::Hook;
+		using PointerTableHook::UnHook;
+
+		template<
+			typename Definition,
+			typename Traits = FunctionTraits<Definition>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		bool Hook( Definition method, void *detour )
+		{
+			const Member member = GetVirtualAddress( originals.data( ), size, method );
+			return member.IsValid( ) && Hook( member.index, detour );
+		}
+
+		template<
+			typename Definition,
+			typename Traits = FunctionTraits<Definition>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		bool UnHook( Definition method )
+		{
+			const Member member = GetVirtualAddress( originals.data( ), size, method );
+			return member.IsValid( ) && UnHook( member.index );
+		}
+
+		void **GetVirtualTable( ) const;
+
+		// Calls the original of the slot the member function pointer resolves to
+		template<
+			typename Definition,
+			typename... Args,
+			typename Traits = FunctionTraits<Definition>,
+			typename ReturnType = typename Traits::ReturnType,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		ReturnType CallOriginal( Definition method, typename Traits::TargetClass *instance, Args &&... args ) const
+		{
+			void **vtable = const_cast<void **>( originals.data( ) );
+			const Member member = GetVirtualAddress( vtable, size, method );
+			if( !member.IsValid( ) )
+				return ReturnType( );
+
+			return CallMemberAddress<Definition>( instance, member.address, 0, std::forward<Args>( args )... );
+		}
+
+		// Definition is either the member function pointer type or a function taking the object first
+		template<
+			typename Definition,
+			typename Class,
+			typename... Args,
+			typename Traits = FunctionTraits<Definition>,
+			typename ReturnType = typename Traits::ReturnType
+		>
+		ReturnType CallOriginal( size_t index, Class *instance, Args &&... args ) const
+		{
+			void *original = GetOriginal( index );
+			if( original == nullptr )
+				return ReturnType( );
+
+			if constexpr( Traits::IsMemberFunctionPointer )
+				return CallMemberAddress<Definition>( instance, original, 0, std::forward<Args>( args )... );
+			else
+				return reinterpret_cast<Definition>( original )( instance, std::forward<Args>( args )... );
+		}
+	};
+}
@@ -0,0 +1,132 @@
+/*************************************************************************
+* Detouring::VirtualTableIndex
+* Module wide index of virtual tables and the functions they hold.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "helpers.hpp"
+#include "hook.hpp"
+#include "pointermap.hpp"
+#include "platform.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace Detouring
+{
+	// Finds every virtual table with RTTI in a module by its offset to top and type info header,
+	// only ELF modules are supported
+	class VirtualTableIndex
+	{
+	public:
+		struct Slot
+		{
+			void **vtable;
+			size_t index;
+		};
+
+		VirtualTableIndex( ) = default;
+		VirtualTableIndex( const Hook::Module &module );
+
+		bool IsValid( ) const;
+
+		bool Create( const Hook::Module &module );
+		bool Destroy( );
+
+		size_t GetVirtualTableCount( ) const;
+
+		// Address points of every primary and secondary table found
+		std::vector<void **> GetVirtualTables( ) const;
+
+		size_t GetVirtualTableSize( void **vtable ) const;
+
+		// Every slot holding the function, empty when it isn't virtual
+		const std::vector<Slot> &FindSlots( void *function ) const;
+
+		// Returns ~0 if the function isn't in the table
+		size_t FindIndex( void **vtable, void *function ) const;
+
+		// Same as Detouring::GetVirtualAddress with the indexed table size, non virtual pointers are looked up
+		// through the index instead of comparing every entry
+		template<
+			typename Definition,
+			typename Traits = FunctionTraits<Definition>,
+			std::enable_if_t<Traits::IsMemberFunctionPointer, int> = 0
+		>
+		Member GetVirtualAddress( void **vtable, Definition method ) const
+		{
+			const size_t size = GetVirtualTableSize( vtable );
+			if( size == 0 || method == nullptr )
+				return Member( );
+
+			const size_t index = GetVirtualIndex( method );
+			if( index != static_cast<size_t>( ~0 ) )
+				return index < size ? Member( index, vtable[index] ) : Member( );
+
+			void *address = GetAddress( method );
+			const size_t position = FindIndex( vtable, address );
+			return position < size ? Member( position, address ) : Member( );
+		}
+
+		// Slots of derived classes (through primary bases) that replace the entry of a primary table
+		std::vector<Slot> FindOverrides( void **vtable, size_t index ) const;
+
+		// Same slot in every class derived through primary bases, whether it overrides the entry or inherits it
+		std::vector<Slot> FindDerivedSlots( void **vtable, size_t index ) const;
+
+	private:
+		struct Table
+		{
+			void **pointer;
+			size_t size;
+			void *typeinfo;
+			bool primary;
+		};
+
+		void CollectDerived(
+			void *typeinfo,
+			void *function,
+			size_t index,
+			bool overrides_only,
+			std::vector<Slot> &derived
+		) const;
+
+		std::vector<Table> tables;
+		PointerMap<size_t> table_indices;
+		PointerMap<size_t> primary_tables;
+		PointerMap<std::vector<Slot>> slots;
+		PointerMap<std::vector<void *>> derived_classes;
+	};
+}
@@ -0,0 +1,96 @@
+/*************************************************************************
+* Detouring::VirtualTableProfiler
+* Counts calls going through each slot of a virtual table.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "callprofiler.hpp"
+#include "helpers.hpp"
+#include "platform.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace Detouring
+{
+	// Points every slot at a CallProfiler stub that counts the call in its thread's shard and jumps to the original
+	class VirtualTableProfiler
+	{
+	public:
+		struct Result
+		{
+			size_t index;
+			void *function;
+			uint64_t calls;
+			uint64_t cycles;
+		};
+
+		VirtualTableProfiler( ) = default;
+		VirtualTableProfiler( void **vtable, size_t size = 0, bool measure_cycles = false );
+
+		VirtualTableProfiler( const VirtualTableProfiler & ) = delete;
+		VirtualTableProfiler( VirtualTableProfiler && ) = delete;
+
+		~VirtualTableProfiler( );
+
+		VirtualTableProfiler &operator=( const VirtualTableProfiler & ) = delete;
+		VirtualTableProfiler &operator=( VirtualTableProfiler && ) = delete;
+
+		bool IsValid( ) const;
+
+		// A size of 0 uses GetVirtualTableSize, see CallProfiler for the caveats of measuring cycles
+		bool Create( void **vtable, size_t size = 0, bool measure_cycles = false );
+
+		// No thread may be running a profiled method when the stubs are freed
+		bool Destroy( );
+
+		bool IsEnabled( ) const;
+		bool Enable( );
+		bool Disable( );
+
+		size_t GetSize( ) const;
+
+		void *GetOriginal( size_t index ) const;
+
+		// Cycles are inclusive of nested calls and zero unless measured
+		std::vector<Result> GetResults( ) const;
+
+		void Reset( );
+
+	private:
+		void **vtable = nullptr;
+		CallProfiler profiler;
+	};
+}
@@ -0,0 +1,83 @@
+/*************************************************************************
+* Detouring::WritableRegion
+* Keeps a range of pages writable so pointers in it can be swapped without syscalls.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#pragma once
+
+#include "helpers.hpp"
+#include "platform.hpp"
+
+#include <cstdint>
+#include <cstddef>
+
+namespace Detouring
+{
+	// Unprotects the pages once and restores them on destruction, slot swaps in between are plain atomics
+	// The pages stay writable for the whole lifetime of the region, which for code or vtables in
+	// executable segments means RWX, so keep regions short lived and as small as possible
+	class WritableRegion
+	{
+	public:
+		WritableRegion( ) = default;
+		WritableRegion( void *address, size_t length );
+
+		WritableRegion( const WritableRegion & ) = delete;
+		WritableRegion( WritableRegion && ) = delete;
+
+		~WritableRegion( );
+
+		WritableRegion &operator=( const WritableRegion & ) = delete;
+		WritableRegion &operator=( WritableRegion && ) = delete;
+
+		bool IsValid( ) const;
+
+		// Every page in the range must share the same protection
+		bool Create( void *address, size_t length );
+		bool Destroy( );
+
+		bool Contains( const void *address, size_t length = sizeof( void * ) ) const;
+
+		bool Store( void **slot, void *value );
+
+		// Returns the previous value, or nullptr if the slot is outside the region or misaligned
+		void *Exchange( void **slot, void *value );
+
+		bool CompareExchange( void **slot, void *&expected, void *desired );
+
+	private:
+		uintptr_t start = 0;
+		uintptr_t end = 0;
+		int32_t protection = MemoryProtection::Error;
+	};
+}
@@ -0,0 +1,436 @@
+/*************************************************************************
+* Detouring::CallProfiler
+* Generated stubs counting calls and cycles on their way to a target.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "callprofiler.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#if defined ARCHITECTURE_X86_64 && !defined SYSTEM_WINDOWS
+
+#include <x86intrin.h>
+
+#define DETOURING_PROFILER_CYCLES 1
+
+#endif
+
+namespace Detouring
+{
+	// Every shard has its own cache lines, counting stubs pick one by hashing the thread pointer
+	// or id out of the thread block, cycle measurements by a per thread index
+	static constexpr unsigned int shard_bits = 6;
+	static constexpr size_t shard_count = 1 << shard_bits;
+	static constexpr size_t cache_line_size = 64;
+	static constexpr uint64_t shard_hash64 = 0x9E3779B97F4A7C15ULL;
+	static constexpr uint32_t shard_hash32 = 0x9E3779B1;
+
+#if defined ARCHITECTURE_X86_64
+
+	static constexpr size_t stub_size = 64;
+
+#else
+
+	static constexpr size_t stub_size = 48;
+
+#endif
+
+#if defined DETOURING_PROFILER_CYCLES
+
+	static constexpr size_t cycles_stub_size = 192;
+
+	// Calls nested deeper than this are counted without measuring their cycles
+	static constexpr size_t max_frames = 256;
+
+	struct Frame
+	{
+		void *site;
+		void *return_address;
+		uint64_t start;
+	};
+
+	// Fixed size so entering a call never allocates, the allocator itself might be profiled
+	struct FrameStack
+	{
+		Frame frames[max_frames];
+		size_t depth;
+	};
+
+	static thread_local FrameStack frame_stack;
+
+	static size_t GetThreadShard( )
+	{
+		static std::atomic<size_t> next_shard( 0 );
+		static thread_local const size_t shard = next_shard.fetch_add( 1, std::memory_order_relaxed ) % shard_count;
+		return shard;
+	}
+
+#endif
+
+	template<size_t Size>
+	static uint8_t *Emit( uint8_t *code, const uint8_t ( &bytes )[Size] )
+	{
+		std::memcpy( code, bytes, Size );
+		return code + Size;
+	}
+
+	template<typename Value>
+	static uint8_t *EmitValue( uint8_t *code, Value value )
+	{
+		std::memcpy( code, &value, sizeof( value ) );
+		return code + sizeof( value );
+	}
+
+	static void WriteCountingStub( uint8_t *code, std::atomic<uint64_t> *counter, size_t stride, void *target )
+	{
+		const uint32_t shard_stride = static_cast<uint32_t>( stride * sizeof( uint64_t ) );
+
+#if defined ARCHITECTURE_X86_64
+
+		// Only r10 and r11 are touched, they're scratch on both ABIs and carry no arguments
+
+#if defined SYSTEM_WINDOWS
+
+		// mov r10, gs:[0x48] (thread id)
+		code = Emit( code, { 0x65, 0x4C, 0x8B, 0x14, 0x25, 0x48, 0x00, 0x00, 0x00 } );
+
+#elif defined SYSTEM_MACOSX
+
+		// mov r10, gs:[0] (pthread self)
+		code = Emit( code, { 0x65, 0x4C, 0x8B, 0x14, 0x25, 0x00, 0x00, 0x00, 0x00 } );
+
+#else
+
+		// mov r10, fs:[0] (thread control block)
+		code = Emit( code, { 0x64, 0x4C, 0x8B, 0x14, 0x25, 0x00, 0x00, 0x00, 0x00 } );
+
+#endif
+
+		// mov r11, imm64; imul r10, r11; shr r10, 64 - shard_bits
+		code = EmitValue( Emit( code, { 0x49, 0xBB } ), shard_hash64 );
+		code = Emit( code, { 0x4D, 0x0F, 0xAF, 0xD3, 0x49, 0xC1, 0xEA, 64 - shard_bits } );
+		// imul r10d, r10d, imm32
+		code = EmitValue( Emit( code, { 0x45, 0x69, 0xD2 } ), shard_stride );
+		// mov r11, imm64
+		code = EmitValue( Emit( code, { 0x49, 0xBB } ), counter );
+		// lock inc qword ptr [r11+r10]
+		code = Emit( code, { 0xF0, 0x4B, 0xFF, 0x04, 0x13 } );
+		// jmp qword ptr [rip+0]
+		code = EmitValue( Emit( code, { 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 } ), target );
+
+#else
+
+		const uint32_t address = static_cast<uint32_t>( reinterpret_cast<uintptr_t>( counter ) );
+
+		// eax is free on entry for cdecl and thiscall
+
+#if defined SYSTEM_WINDOWS
+
+		// mov eax, fs:[0x24] (thread id)
+		code = Emit( code, { 0x64, 0xA1, 0x24, 0x00, 0x00, 0x00 } );
+
+#else
+
+		// mov eax, gs:[0] (thread control block)
+		code = Emit( code, { 0x65, 0xA1, 0x00, 0x00, 0x00, 0x00 } );
+
+#endif
+
+		// imul eax, eax, imm32; shr eax, 32 - shard_bits
+		code = EmitValue( Emit( code, { 0x69, 0xC0 } ), shard_hash32 );
+		code = Emit( code, { 0xC1, 0xE8, 32 - shard_bits } );
+		// imul eax, eax, imm32
+		code = EmitValue( Emit( code, { 0x69, 0xC0 } ), shard_stride );
+		// lock add dword ptr [eax+imm32], 1
+		code = Emit( EmitValue( Emit( code, { 0xF0, 0x83, 0x80 } ), address ), { 0x01 } );
+		// lock adc dword ptr [eax+imm32+4], 0
+		code = Emit( EmitValue( Emit( code, { 0xF0, 0x83, 0x90 } ), address + 4 ), { 0x00 } );
+		// jmp rel32
+		const int32_t displacement = static_cast<int32_t>(
+			reinterpret_cast<intptr_t>( target ) - reinterpret_cast<intptr_t>( code + 5 )
+		);
+		code = EmitValue( Emit( code, { 0xE9 } ), displacement );
+
+#endif
+
+	}
+
+#if defined DETOURING_PROFILER_CYCLES
+
+	// Every target returns through here while its cycles are measured
+	uint8_t *CallProfiler::GetReturnStub( )
+	{
+		static uint8_t *stub = nullptr;
+		static std::once_flag once;
+		std::call_once( once, [] {
+			uint8_t *code = static_cast<uint8_t *>( AllocateExecutableBlock( stub_size ) );
+			if( code == nullptr )
+				return;
+
+			stub = code;
+			// push rax; push rdx; sub rsp, 32
+			code = Emit( code, { 0x50, 0x52, 0x48, 0x83, 0xEC, 0x20 } );
+			// movdqu [rsp], xmm0; movdqu [rsp+16], xmm1
+			code = Emit( code, { 0xF3, 0x0F, 0x7F, 0x04, 0x24, 0xF3, 0x0F, 0x7F, 0x4C, 0x24, 0x10 } );
+			// mov rax, imm64; call rax
+			code = Emit( EmitValue( Emit( code, { 0x48, 0xB8 } ), &LeaveCall ), { 0xFF, 0xD0 } );
+			// mov r11, rax
+			code = Emit( code, { 0x49, 0x89, 0xC3 } );
+			// movdqu xmm0, [rsp]; movdqu xmm1, [rsp+16]
+			code = Emit( code, { 0xF3, 0x0F, 0x6F, 0x04, 0x24, 0xF3, 0x0F, 0x6F, 0x4C, 0x24, 0x10 } );
+			// add rsp, 32; pop rdx; pop rax; jmp r11
+			code = Emit( code, { 0x48, 0x83, 0xC4, 0x20, 0x5A, 0x58, 0x41, 0xFF, 0xE3 } );
+		} );
+		return stub;
+	}
+
+	void CallProfiler::EnterCall( Site *site, void **return_slot )
+	{
+		FrameStack &stack = frame_stack;
+		if( stack.depth == max_frames )
+		{
+			// The call returns straight to its caller, so there's no frame to pop later
+			site->counters[GetThreadShard( ) * site->stride].fetch_add( 1, std::memory_order_relaxed );
+			return;
+		}
+
+		stack.frames[stack.depth++] = { site, *return_slot, __rdtsc( ) };
+		*return_slot = GetReturnStub( );
+	}
+
+	void *CallProfiler::LeaveCall( )
+	{
+		const uint64_t end = __rdtsc( );
+		FrameStack &stack = frame_stack;
+		const Frame frame = stack.frames[--stack.depth];
+
+		const Site *site = static_cast<const Site *>( frame.site );
+		std::atomic<uint64_t> *counters = site->counters + GetThreadShard( ) * site->stride;
+		counters[0].fetch_add( 1, std::memory_order_relaxed );
+		counters[1].fetch_add( end - frame.start, std::memory_order_relaxed );
+		return frame.return_address;
+	}
+
+	void CallProfiler::WriteCyclesStub( uint8_t *code, Site *site, void *target )
+	{
+		// Save every argument register, System V passes up to eight in xmm registers and al counts them
+		// push rdi; push rsi; push rdx; push rcx; push r8; push r9; push rax
+		code = Emit( code, { 0x57, 0x56, 0x52, 0x51, 0x41, 0x50, 0x41, 0x51, 0x50 } );
+		// sub rsp, 128
+		code = Emit( code, { 0x48, 0x81, 0xEC, 0x80, 0x00, 0x00, 0x00 } );
+		// movdqu [rsp+16*n], xmmn
+		code = Emit( code, { 0xF3, 0x0F, 0x7F, 0x04, 0x24 } );
+		for( uint8_t n = 1; n < 8; ++n )
+			code = Emit( code, { 0xF3, 0x0F, 0x7F, static_cast<uint8_t>( 0x44 | n << 3 ), 0x24, static_cast<uint8_t>( n * 16 ) } );
+
+		// lea rsi, [rsp+184] (the return address)
+		code = Emit( code, { 0x48, 0x8D, 0xB4, 0x24, 0xB8, 0x00, 0x00, 0x00 } );
+		// mov rdi, imm64
+		code = EmitValue( Emit( code, { 0x48, 0xBF } ), site );
+		// mov rax, imm64; call rax
+		code = Emit( EmitValue( Emit( code, { 0x48, 0xB8 } ), &EnterCall ), { 0xFF, 0xD0 } );
+
+		// movdqu xmmn, [rsp+16*n]
+		code = Emit( code, { 0xF3, 0x0F, 0x6F, 0x04, 0x24 } );
+		for( uint8_t n = 1; n < 8; ++n )
+			code = Emit( code, { 0xF3, 0x0F, 0x6F, static_cast<uint8_t>( 0x44 | n << 3 ), 0x24, static_cast<uint8_t>( n * 16 ) } );
+
+		// add rsp, 128
+		code = Emit( code, { 0x48, 0x81, 0xC4, 0x80, 0x00, 0x00, 0x00 } );
+		// pop rax; pop r9; pop r8; pop rcx; pop rdx; pop rsi; pop rdi
+		code = Emit( code, { 0x58, 0x41, 0x59, 0x41, 0x58, 0x59, 0x5A, 0x5E, 0x5F } );
+		// jmp qword ptr [rip+0]
+		code = EmitValue( Emit( code, { 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 } ), target );
+	}
+
+#endif
+
+	CallProfiler::~CallProfiler( )
+	{
+		Destroy( );
+	}
+
+	bool CallProfiler::IsCyclesSupported( )
+	{
+
+#if defined DETOURING_PROFILER_CYCLES
+
+		return true;
+
+#else
+
+		return false;
+
+#endif
+
+	}
+
+	bool CallProfiler::IsValid( ) const
+	{
+		return stubs != nullptr && size != 0;
+	}
+
+	size_t CallProfiler::GetStubSize( ) const
+	{
+
+#if defined DETOURING_PROFILER_CYCLES
+
+		if( measure_cycles )
+			return cycles_stub_size;
+
+#endif
+
+		return stub_size;
+	}
+
+	void CallProfiler::CounterDeleter::operator()( std::atomic<uint64_t> *counters ) const
+	{
+		::operator delete[]( counters, std::align_val_t( cache_line_size ) );
+	}
+
+	bool CallProfiler::Create( void *const *_targets, size_t count, bool _measure_cycles, void *nearby )
+	{
+		if( IsValid( ) || _targets == nullptr || count == 0 || ( _measure_cycles && !IsCyclesSupported( ) ) )
+			return false;
+
+		measure_cycles = _measure_cycles;
+		const size_t slot_stub_size = GetStubSize( );
+		uint8_t *code = static_cast<uint8_t *>( AllocateExecutableBlock( count * slot_stub_size, nearby ) );
+		if( code == nullptr )
+		{
+			measure_cycles = false;
+			return false;
+		}
+
+		const size_t line = cache_line_size / sizeof( uint64_t );
+		shard_stride = ( count * 2 + line - 1 ) / line * line;
+		const size_t counter_count = shard_count * shard_stride;
+		counters.reset( static_cast<std::atomic<uint64_t> *>(
+			::operator new[]( counter_count * sizeof( std::atomic<uint64_t> ), std::align_val_t( cache_line_size ) )
+		) );
+		for( size_t k = 0; k < counter_count; ++k )
+			new( &counters[k] ) std::atomic<uint64_t>( 0 );
+
+		sites.reset( new Site[count] );
+		targets.assign( _targets, _targets + count );
+		for( size_t k = 0; k < count; ++k )
+		{
+			sites[k] = { &counters[k * 2], shard_stride };
+
+#if defined DETOURING_PROFILER_CYCLES
+
+			if( measure_cycles )
+			{
+				WriteCyclesStub( code + k * slot_stub_size, &sites[k], targets[k] );
+				continue;
+			}
+
+#endif
+
+			WriteCountingStub( code + k * slot_stub_size, &counters[k * 2], shard_stride, targets[k] );
+		}
+
+		size = count;
+		stubs = code;
+		return true;
+	}
+
+	bool CallProfiler::Destroy( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		FreeExecutableBlock( stubs, size * GetStubSize( ) );
+		stubs = nullptr;
+		size = 0;
+		measure_cycles = false;
+		shard_stride = 0;
+		targets.clear( );
+		counters.reset( );
+		sites.reset( );
+		return true;
+	}
+
+	bool CallProfiler::IsMeasuringCycles( ) const
+	{
+		return measure_cycles;
+	}
+
+	size_t CallProfiler::GetSize( ) const
+	{
+		return size;
+	}
+
+	void *CallProfiler::GetStub( size_t index ) const
+	{
+		if( !IsValid( ) || index >= size )
+			return nullptr;
+
+		return stubs + index * GetStubSize( );
+	}
+
+	void *CallProfiler::GetTarget( size_t index ) const
+	{
+		if( !IsValid( ) || index >= size )
+			return nullptr;
+
+		return targets[index];
+	}
+
+	CallProfiler::Result CallProfiler::GetResult( size_t index ) const
+	{
+		Result result = { 0, 0 };
+		if( !IsValid( ) || index >= size )
+			return result;
+
+		for( size_t shard = 0; shard < shard_count; ++shard )
+		{
+			const std::atomic<uint64_t> *pair = &counters[shard * shard_stride + index * 2];
+			result.calls += pair[0].load( std::memory_order_relaxed );
+			result.cycles += pair[1].load( std::memory_order_relaxed );
+		}
+
+		return result;
+	}
+
+	void CallProfiler::Reset( )
+	{
+		if( !IsValid( ) )
+			return;
+
+		for( size_t k = 0; k < shard_count * shard_stride; ++k )
+			counters[k].store( 0, std::memory_order_relaxed );
+	}
+}
@@ -0,0 +1,464 @@
+/*************************************************************************
+* Detouring::CallSiteHook
+* A C++ class that allows you to redirect the direct calls to a function
+* without modifying the function itself.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "callsitehook.hpp"
+#include "helpers.hpp"
+#include "platform.hpp"
+#include "elf.hpp"
+#include "disassembler.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined SYSTEM_LINUX
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
+#include <dlfcn.h>
+
+#endif
+
+namespace Detouring
+{
+
+#if defined SYSTEM_LINUX
+
+	static constexpr size_t relay_size = 16;
+
+	// call rel32, jmp rel32 and jcc rel32
+	static uint8_t *GetRelativeDestination( uint8_t *code, const InstructionInfo &info, unsigned int length )
+	{
+		if( ( info.flags & F_ERROR ) != 0 || info.p_66 != 0 || length < 5 )
+			return nullptr;
+
+		if( info.opcode != 0xE8 && info.opcode != 0xE9 &&
+			( info.opcode != 0x0F || ( info.opcode2 & 0xF0 ) != 0x80 ) )
+			return nullptr;
+
+		int32_t displacement = 0;
+		std::memcpy( &displacement, code + length - 4, sizeof( displacement ) );
+		return code + length + displacement;
+	}
+
+	static bool IsReachable( const uint8_t *next, const void *destination )
+	{
+
+#ifdef ARCHITECTURE_X86_64
+
+		const intptr_t distance = static_cast<const uint8_t *>( destination ) - next;
+		return distance >= INT32_MIN && distance <= INT32_MAX;
+
+#else
+
+		(void)next;
+		(void)destination;
+		return true;
+
+#endif
+
+	}
+
+	// Avoids torn displacements for threads executing the call sites, whenever the alignment allows it
+	static void WriteDisplacement( uint8_t *address, int32_t value )
+	{
+		const uintptr_t offset = reinterpret_cast<uintptr_t>( address ) % sizeof( uint64_t );
+		if( offset > sizeof( uint64_t ) - sizeof( int32_t ) )
+		{
+			std::memcpy( address, &value, sizeof( value ) );
+			return;
+		}
+
+		uint64_t *word = reinterpret_cast<uint64_t *>( address - offset );
+		uint64_t expected = __atomic_load_n( word, __ATOMIC_RELAXED ), desired = 0;
+		do
+		{
+			desired = expected;
+			std::memcpy( reinterpret_cast<uint8_t *>( &desired ) + offset, &value, sizeof( value ) );
+		}
+		while( !__atomic_compare_exchange_n( word, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) );
+	}
+
+#endif
+
+	CallSiteHook::CallSiteHook( const Hook::Target &_target, void *_detour )
+	{
+		Create( _target, _detour );
+	}
+
+	CallSiteHook::CallSiteHook(
+		const Hook::Target &_target,
+		void *_detour,
+		const std::vector<Hook::Module> &modules
+	)
+	{
+		Create( _target, _detour, modules );
+	}
+
+	CallSiteHook::~CallSiteHook( )
+	{
+		Destroy( );
+	}
+
+	bool CallSiteHook::IsValid( ) const
+	{
+		return target != nullptr && detour != nullptr;
+	}
+
+	bool CallSiteHook::Create( const Hook::Target &_target, void *_detour )
+	{
+		return Create( _target, _detour, { } );
+	}
+
+	bool CallSiteHook::Create(
+		const Hook::Target &_target,
+		void *_detour,
+		const std::vector<Hook::Module> &modules
+	)
+	{
+		if( IsValid( ) || !_target.IsValid( ) || _detour == nullptr )
+			return false;
+
+#if defined SYSTEM_LINUX
+
+		void *pointer = nullptr;
+		if( _target.IsPointer( ) )
+			pointer = _target.GetPointer( );
+		else
+			pointer = dlsym( RTLD_DEFAULT, _target.GetName( ).c_str( ) );
+
+		if( pointer == nullptr )
+			return false;
+
+		target = pointer;
+		detour = _detour;
+		if( !Scan( modules ) )
+		{
+			Destroy( );
+			return false;
+		}
+
+		return true;
+
+#else
+
+		(void)modules;
+		return false;
+
+#endif
+
+	}
+
+	bool CallSiteHook::Destroy( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		Disable( );
+
+		// Sites that couldn't be restored still jump into their relay, those relays are leaked instead
+		std::vector<void *> used;
+		for( const Region &region : regions )
+			for( const Site &site : region.sites )
+			{
+				int32_t current = 0;
+				std::memcpy( &current, site.displacement, sizeof( current ) );
+				if( current == site.redirected )
+					used.push_back( site.displacement + sizeof( int32_t ) + site.redirected );
+			}
+
+		for( void *relay : relays )
+			if( std::find( used.begin( ), used.end( ), relay ) == used.end( ) )
+				FreeExecutableBlock( relay, relay_size );
+
+		regions.clear( );
+		relays.clear( );
+		target = nullptr;
+		detour = nullptr;
+		return true;
+	}
+
+	bool CallSiteHook::IsEnabled( ) const
+	{
+		return IsValid( ) && enabled;
+	}
+
+	bool CallSiteHook::Enable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		if( enabled )
+			return true;
+
+		enabled = Write( true );
+		return enabled;
+	}
+
+	bool CallSiteHook::Disable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		if( !enabled )
+			return true;
+
+		enabled = !Write( false );
+		return !enabled;
+	}
+
+	size_t CallSiteHook::GetSiteCount( ) const
+	{
+		size_t count = 0;
+		for( const Region &region : regions )
+			count += region.sites.size( );
+
+		return count;
+	}
+
+	void *CallSiteHook::GetTarget( ) const
+	{
+		return target;
+	}
+
+	void *CallSiteHook::GetDetour( ) const
+	{
+		return detour;
+	}
+
+	void *CallSiteHook::GetTrampoline( ) const
+	{
+		return target;
+	}
+
+	bool CallSiteHook::Scan( const std::vector<Hook::Module> &modules )
+	{
+
+#if defined SYSTEM_LINUX
+
+		std::vector<Elf::Image> images;
+		if( modules.empty( ) )
+		{
+			// Our own calls to the target are left alone
+			const Elf::Image detour_image = Elf::Image::FromAddress( detour );
+			for( Elf::Image &image : Elf::Image::GetLoaded( ) )
+				if( !detour_image.IsValid( ) ||
+					image.GetBase( ) != detour_image.GetBase( ) ||
+					image.GetName( ) != detour_image.GetName( ) )
+					images.push_back( std::move( image ) );
+		}
+		else
+		{
+			for( const Hook::Module &module : modules )
+			{
+				Elf::Image image = Elf::Image::FromModule( module );
+				if( !image.IsValid( ) )
+					return false;
+
+				images.push_back( std::move( image ) );
+			}
+		}
+
+		for( const Elf::Image &image : images )
+		{
+			// Executable segments also hold read only data and unwind tables, only code sections are swept
+			const std::vector<uintptr_t> functions = image.GetFunctionStarts( );
+			std::vector<Elf::Segment> sections = image.GetExecutableSections( );
+			std::sort( sections.begin( ), sections.end( ), []( const Elf::Segment &a, const Elf::Segment &b )
+			{
+				return a.start < b.start;
+			} );
+
+			for( const Elf::Segment &segment : image.GetSegments( ) )
+			{
+				if( ( segment.protection & MemoryProtection::Execute ) == 0 )
+					continue;
+
+				Region region = { 0, 0, segment.protection, { } };
+				for( const Elf::Segment &section : sections )
+				{
+					if( section.start < segment.start || section.start + section.size > segment.start + segment.size )
+						continue;
+
+					// Sites are only kept when decoding lands exactly on the next known function start,
+					// a sweep that failed or walked over one may have read data or padding as instructions
+					uint8_t *code = reinterpret_cast<uint8_t *>( section.start );
+					uint8_t *end = code + section.size;
+					auto function = std::upper_bound( functions.begin( ), functions.end( ), section.start );
+					std::vector<Site> pending;
+					while( code < end )
+					{
+						if( function != functions.end( ) && *function < reinterpret_cast<uintptr_t>( end ) &&
+							reinterpret_cast<uintptr_t>( code ) >= *function )
+						{
+							if( reinterpret_cast<uintptr_t>( code ) == *function )
+								region.sites.insert( region.sites.end( ), pending.begin( ), pending.end( ) );
+
+							pending.clear( );
+							code = reinterpret_cast<uint8_t *>( *function++ );
+							continue;
+						}
+
+						InstructionInfo info;
+						const unsigned int length = Disassemble( code, end, info );
+						if( length == 0 || ( info.flags & F_ERROR ) != 0 )
+						{
+							// Resume at the next function, there's no telling where the next instruction starts
+							pending.clear( );
+							if( function == functions.end( ) || *function >= reinterpret_cast<uintptr_t>( end ) )
+								break;
+
+							code = reinterpret_cast<uint8_t *>( *function );
+							continue;
+						}
+
+						if( GetRelativeDestination( code, info, length ) == target )
+						{
+							uint8_t *next = code + length;
+							void *destination = IsReachable( next, detour ) ? detour : GetRelay( next );
+							if( destination != nullptr )
+							{
+								int32_t original = 0;
+								std::memcpy( &original, next - 4, sizeof( original ) );
+								const int32_t redirected = static_cast<int32_t>(
+									reinterpret_cast<uintptr_t>( destination ) - reinterpret_cast<uintptr_t>( next )
+								);
+								pending.push_back( { next - 4, original, redirected } );
+							}
+						}
+
+						code += length;
+					}
+
+					if( code == end )
+						region.sites.insert( region.sites.end( ), pending.begin( ), pending.end( ) );
+				}
+
+				if( region.sites.empty( ) )
+					continue;
+
+				region.start = reinterpret_cast<uintptr_t>( region.sites.front( ).displacement );
+				region.end = reinterpret_cast<uintptr_t>( region.sites.back( ).displacement ) + sizeof( int32_t );
+				regions.push_back( std::move( region ) );
+			}
+		}
+
+		return !regions.empty( );
+
+#else
+
+		(void)modules;
+		return false;
+
+#endif
+
+	}
+
+	void *CallSiteHook::GetRelay( uint8_t *next )
+	{
+
+#if defined SYSTEM_LINUX && defined ARCHITECTURE_X86_64
+
+		for( void *relay : relays )
+			if( IsReachable( next, relay ) )
+				return relay;
+
+		uint8_t *relay = static_cast<uint8_t *>( AllocateExecutableBlock( relay_size, next ) );
+		if( relay == nullptr )
+			return nullptr;
+
+		if( !IsReachable( next, relay ) )
+		{
+			FreeExecutableBlock( relay, relay_size );
+			return nullptr;
+		}
+
+		// jmp qword ptr [rip + 0]
+		const uint8_t jump[] = { 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 };
+		std::memcpy( relay, jump, sizeof( jump ) );
+		std::memcpy( relay + sizeof( jump ), &detour, sizeof( detour ) );
+
+		relays.push_back( relay );
+		return relay;
+
+#else
+
+		(void)next;
+		return nullptr;
+
+#endif
+
+	}
+
+	bool CallSiteHook::Write( bool redirect )
+	{
+
+#if defined SYSTEM_LINUX
+
+		bool success = true;
+		for( const Region &region : regions )
+		{
+			void *address = reinterpret_cast<void *>( region.start );
+			const size_t length = static_cast<size_t>( region.end - region.start );
+			if( !SetMemoryProtection( address, length, region.protection | MemoryProtection::Write ) )
+			{
+				success = false;
+				continue;
+			}
+
+			for( const Site &site : region.sites )
+			{
+				int32_t current = 0;
+				std::memcpy( &current, site.displacement, sizeof( current ) );
+				if( current == ( redirect ? site.original : site.redirected ) )
+					WriteDisplacement( site.displacement, redirect ? site.redirected : site.original );
+			}
+
+			SetMemoryProtection( address, length, region.protection );
+		}
+
+		return success;
+
+#else
+
+		(void)redirect;
+		return false;
+
+#endif
+
+	}
+}
@@ -0,0 +1,714 @@
+/*************************************************************************
+* Detouring::Elf
+* C++ helpers for inspecting ELF images loaded in the current process.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "elf.hpp"
+#include "helpers.hpp"
+
+#if defined SYSTEM_LINUX
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
+#include <dlfcn.h>
+#include <elf.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined ARCHITECTURE_X86_64
+
+#define DETOURING_ST_TYPE ELF64_ST_TYPE
+#define DETOURING_R_SYM ELF64_R_SYM
+#define DETOURING_R_TYPE ELF64_R_TYPE
+#define DETOURING_R_JUMP_SLOT R_X86_64_JUMP_SLOT
+#define DETOURING_R_GLOB_DAT R_X86_64_GLOB_DAT
+#define DETOURING_R_IRELATIVE R_X86_64_IRELATIVE
+
+#else
+
+#define DETOURING_ST_TYPE ELF32_ST_TYPE
+#define DETOURING_R_SYM ELF32_R_SYM
+#define DETOURING_R_TYPE ELF32_R_TYPE
+#define DETOURING_R_JUMP_SLOT R_386_JMP_SLOT
+#define DETOURING_R_GLOB_DAT R_386_GLOB_DAT
+#define DETOURING_R_IRELATIVE R_386_IRELATIVE
+
+#endif
+
+namespace Detouring
+{
+	namespace Elf
+	{
+		static const char *GetBaseName( const char *path )
+		{
+			const char *slash = std::strrchr( path, '/' );
+			return slash != nullptr ? slash + 1 : path;
+		}
+
+		static uint32_t GnuHash( const char *name )
+		{
+			uint32_t hash = 5381;
+			for( const uint8_t *c = reinterpret_cast<const uint8_t *>( name ); *c != 0; ++c )
+				hash = hash * 33 + *c;
+
+			return hash;
+		}
+
+		static uint32_t SysvHash( const char *name )
+		{
+			uint32_t hash = 0;
+			for( const uint8_t *c = reinterpret_cast<const uint8_t *>( name ); *c != 0; ++c )
+			{
+				hash = ( hash << 4 ) + *c;
+				const uint32_t high = hash & 0xF0000000;
+				if( high != 0 )
+					hash ^= high >> 24;
+
+				hash &= ~high;
+			}
+
+			return hash;
+		}
+
+		// Section headers aren't loaded, they have to be read from the file the image was mapped from
+		static bool ReadSectionHeaders( std::FILE *file, std::vector<ElfW( Shdr )> &headers )
+		{
+			ElfW( Ehdr ) header = { };
+			if(
+				std::fread( &header, sizeof( header ), 1, file ) != 1 ||
+				std::memcmp( header.e_ident, ELFMAG, SELFMAG ) != 0 ||
+				header.e_shentsize != sizeof( ElfW( Shdr ) ) || header.e_shnum == 0 ||
+				std::fseek( file, static_cast<long>( header.e_shoff ), SEEK_SET ) != 0
+			)
+				return false;
+
+			headers.resize( header.e_shnum );
+			return std::fread( headers.data( ), sizeof( ElfW( Shdr ) ), headers.size( ), file ) == headers.size( );
+		}
+
+		static bool IsFunctionSymbol( const ElfW( Sym ) &symbol )
+		{
+			const unsigned char type = DETOURING_ST_TYPE( symbol.st_info );
+			return ( type == STT_FUNC || type == STT_GNU_IFUNC ) && symbol.st_shndx != SHN_UNDEF && symbol.st_value != 0;
+		}
+
+		template<typename Callback>
+		static void IterateLoaded( Callback callback )
+		{
+			dl_iterate_phdr( []( dl_phdr_info *info, size_t, void *data ) -> int
+			{
+				return ( *static_cast<Callback *>( data ) )( *info ) ? 1 : 0;
+			}, &callback );
+		}
+
+		void SegmentSet::Add( const Segment &segment )
+		{
+			segments.push_back( segment );
+		}
+
+		void SegmentSet::Sort( )
+		{
+			std::sort( segments.begin( ), segments.end( ), []( const Segment &a, const Segment &b )
+			{
+				return a.start < b.start;
+			} );
+		}
+
+		bool SegmentSet::Contains( const void *address, size_t size ) const
+		{
+			const uintptr_t value = reinterpret_cast<uintptr_t>( address );
+			auto it = std::upper_bound( segments.begin( ), segments.end( ), value, []( uintptr_t value, const Segment &segment )
+			{
+				return value < segment.start;
+			} );
+			if( it == segments.begin( ) )
+				return false;
+
+			--it;
+			return value - it->start < it->size && it->size - ( value - it->start ) >= size;
+		}
+
+		Image::Image( const dl_phdr_info &info ) :
+			base( info.dlpi_addr ),
+			name( info.dlpi_name != nullptr ? info.dlpi_name : "" ),
+			headers( info.dlpi_phdr ),
+			header_count( info.dlpi_phnum )
+		{
+			const ElfW( Dyn ) *dynamic = nullptr;
+			for( size_t k = 0; k < header_count; ++k )
+				if( headers[k].p_type == PT_DYNAMIC )
+				{
+					dynamic = reinterpret_cast<const ElfW( Dyn ) *>( base + headers[k].p_vaddr );
+					break;
+				}
+
+			if( dynamic == nullptr )
+				return;
+
+			// glibc relocates most of these entries in place, other loaders might not
+			const auto relocate = [this]( ElfW( Addr ) address ) -> uintptr_t
+			{
+				return address < base ? base + address : address;
+			};
+
+			ElfW( Sxword ) plt_relocations_type = DT_NULL;
+			for( const ElfW( Dyn ) *entry = dynamic; entry->d_tag != DT_NULL; ++entry )
+				switch( entry->d_tag )
+				{
+				case DT_SYMTAB:
+					symbols = reinterpret_cast<const ElfW( Sym ) *>( relocate( entry->d_un.d_ptr ) );
+					break;
+
+				case DT_STRTAB:
+					strings = reinterpret_cast<const char *>( relocate( entry->d_un.d_ptr ) );
+					break;
+
+				case DT_VERSYM:
+					versions = reinterpret_cast<const ElfW( Half ) *>( relocate( entry->d_un.d_ptr ) );
+					break;
+
+				case DT_HASH:
+					sysv_hash = reinterpret_cast<const uint32_t *>( relocate( entry->d_un.d_ptr ) );
+					break;
+
+				case DT_GNU_HASH:
+					gnu_hash = reinterpret_cast<const uint32_t *>( relocate( entry->d_un.d_ptr ) );
+					break;
+
+				case DT_PLTGOT:
+					global_offset_table = relocate( entry->d_un.d_ptr );
+					break;
+
+				case DT_JMPREL:
+					plt_relocations = reinterpret_cast<const void *>( relocate( entry->d_un.d_ptr ) );
+					break;
+
+				case DT_PLTRELSZ:
+					plt_relocations_size = entry->d_un.d_val;
+					break;
+
+				case DT_PLTREL:
+					plt_relocations_type = static_cast<ElfW( Sxword )>( entry->d_un.d_val );
+					break;
+
+				case DT_RELA:
+					rela_relocations = reinterpret_cast<const ElfW( Rela ) *>( relocate( entry->d_un.d_ptr ) );
+					break;
+
+				case DT_RELASZ:
+					rela_relocations_size = entry->d_un.d_val;
+					break;
+
+				case DT_REL:
+					rel_relocations = reinterpret_cast<const ElfW( Rel ) *>( relocate( entry->d_un.d_ptr ) );
+					break;
+
+				case DT_RELSZ:
+					rel_relocations_size = entry->d_un.d_val;
+					break;
+
+				default:
+					break;
+				}
+
+			plt_relocations_rela = plt_relocations_type == DT_RELA;
+			symbol_count = CountSymbols( );
+		}
+
+		Image Image::FromName( const std::string &name )
+		{
+			Image image;
+			IterateLoaded( [&image, &name]( const dl_phdr_info &info )
+			{
+				const char *path = info.dlpi_name != nullptr ? info.dlpi_name : "";
+				if( name.empty( ) ? *path != '\0' : name != path && name != GetBaseName( path ) )
+					return false;
+
+				image = Image( info );
+				return true;
+			} );
+			return image;
+		}
+
+		Image Image::FromHandle( void *handle )
+		{
+			link_map *map = nullptr;
+			if( handle == nullptr || dlinfo( handle, RTLD_DI_LINKMAP, &map ) != 0 || map == nullptr )
+				return Image( );
+
+			Image image;
+			IterateLoaded( [&image, map]( const dl_phdr_info &info )
+			{
+				const char *path = info.dlpi_name != nullptr ? info.dlpi_name : "";
+				if( info.dlpi_addr != map->l_addr || std::strcmp( path, map->l_name ) != 0 )
+					return false;
+
+				image = Image( info );
+				return true;
+			} );
+			return image;
+		}
+
+		Image Image::FromAddress( const void *address )
+		{
+			Image image;
+			IterateLoaded( [&image, address]( const dl_phdr_info &info )
+			{
+				Image candidate( info );
+				if( !candidate.Contains( address ) )
+					return false;
+
+				image = std::move( candidate );
+				return true;
+			} );
+			return image;
+		}
+
+		Image Image::FromModule( const Hook::Module &module )
+		{
+			if( !module.IsValid( ) )
+				return Image( );
+
+			if( module.IsPointer( ) )
+				return FromHandle( module.GetPointer( ) );
+
+			const std::wstring &module_name = module.GetModuleName( );
+			return FromName( std::string( module_name.begin( ), module_name.end( ) ) );
+		}
+
+		std::vector<Image> Image::GetLoaded( )
+		{
+			std::vector<Image> images;
+			IterateLoaded( [&images]( const dl_phdr_info &info )
+			{
+				images.emplace_back( info );
+				return false;
+			} );
+			return images;
+		}
+
+		bool Image::IsValid( ) const
+		{
+			return headers != nullptr;
+		}
+
+		uintptr_t Image::GetBase( ) const
+		{
+			return base;
+		}
+
+		const std::string &Image::GetName( ) const
+		{
+			return name;
+		}
+
+		bool Image::Contains( const void *address ) const
+		{
+			const uintptr_t _address = reinterpret_cast<uintptr_t>( address );
+			for( size_t k = 0; k < header_count; ++k )
+			{
+				const ElfW( Phdr ) &header = headers[k];
+				if( header.p_type != PT_LOAD )
+					continue;
+
+				const uintptr_t start = base + header.p_vaddr;
+				if( _address >= start && _address < start + header.p_memsz )
+					return true;
+			}
+
+			return false;
+		}
+
+		std::vector<Segment> Image::GetSegments( ) const
+		{
+			std::vector<Segment> segments;
+			for( size_t k = 0; k < header_count; ++k )
+			{
+				const ElfW( Phdr ) &header = headers[k];
+				if( header.p_type != PT_LOAD )
+					continue;
+
+				int32_t protection = MemoryProtection::None;
+
+				if( ( header.p_flags & PF_R ) != 0 )
+					protection |= MemoryProtection::Read;
+
+				if( ( header.p_flags & PF_W ) != 0 )
+					protection |= MemoryProtection::Write;
+
+				if( ( header.p_flags & PF_X ) != 0 )
+					protection |= MemoryProtection::Execute;
+
+				segments.push_back( { base + header.p_vaddr, header.p_memsz, protection } );
+			}
+
+			return segments;
+		}
+
+		std::vector<Segment> Image::GetExecutableSections( ) const
+		{
+			std::vector<Segment> sections;
+			if( !IsValid( ) )
+				return sections;
+
+			// The file might not be what was loaded, only sections inside executable segments are kept
+			const auto IsMappedCode = [this]( uintptr_t start, size_t size )
+			{
+				for( size_t k = 0; k < header_count; ++k )
+				{
+					const ElfW( Phdr ) &segment = headers[k];
+					if( segment.p_type == PT_LOAD && ( segment.p_flags & PF_X ) != 0 &&
+						start >= base + segment.p_vaddr && start + size <= base + segment.p_vaddr + segment.p_memsz )
+						return true;
+				}
+
+				return false;
+			};
+
+			std::FILE *file = std::fopen( name.empty( ) ? "/proc/self/exe" : name.c_str( ), "rb" );
+			if( file == nullptr )
+				return sections;
+
+			std::vector<ElfW( Shdr )> headers;
+			if( ReadSectionHeaders( file, headers ) )
+				for( const ElfW( Shdr ) &section : headers )
+					if( section.sh_type == SHT_PROGBITS &&
+						( section.sh_flags & ( SHF_ALLOC | SHF_EXECINSTR ) ) == ( SHF_ALLOC | SHF_EXECINSTR ) &&
+						IsMappedCode( base + section.sh_addr, section.sh_size ) )
+						sections.push_back( {
+							base + section.sh_addr,
+							section.sh_size,
+							MemoryProtection::Read | MemoryProtection::Execute
+						} );
+
+			std::fclose( file );
+			return sections;
+		}
+
+		std::vector<uintptr_t> Image::GetFunctionStarts( ) const
+		{
+			std::vector<uintptr_t> starts;
+			if( !IsValid( ) )
+				return starts;
+
+			for( size_t k = 0; k < symbol_count; ++k )
+				if( IsFunctionSymbol( symbols[k] ) )
+					starts.push_back( base + symbols[k].st_value );
+
+			// Local functions are only in the full symbol table, gone if the file was stripped
+			std::FILE *file = std::fopen( name.empty( ) ? "/proc/self/exe" : name.c_str( ), "rb" );
+			if( file != nullptr )
+			{
+				std::vector<ElfW( Shdr )> headers;
+				if( ReadSectionHeaders( file, headers ) )
+					for( const ElfW( Shdr ) &section : headers )
+					{
+						if( section.sh_type != SHT_SYMTAB || section.sh_entsize != sizeof( ElfW( Sym ) ) ||
+							std::fseek( file, static_cast<long>( section.sh_offset ), SEEK_SET ) != 0 )
+							continue;
+
+						std::vector<ElfW( Sym )> entries( section.sh_size / sizeof( ElfW( Sym ) ) );
+						if( std::fread( entries.data( ), sizeof( ElfW( Sym ) ), entries.size( ), file ) != entries.size( ) )
+							continue;
+
+						for( const ElfW( Sym ) &symbol : entries )
+							if( IsFunctionSymbol( symbol ) )
+								starts.push_back( base + symbol.st_value );
+					}
+
+				std::fclose( file );
+			}
+
+			std::sort( starts.begin( ), starts.end( ) );
+			starts.erase( std::unique( starts.begin( ), starts.end( ) ), starts.end( ) );
+			return starts;
+		}
+
+		size_t Image::GetSymbolCount( ) const
+		{
+			return symbol_count;
+		}
+
+		// The GNU hash table has no symbol count, it has to be found by walking the last chain
+		size_t Image::CountSymbols( ) const
+		{
+			if( symbols == nullptr )
+				return 0;
+
+			if( sysv_hash != nullptr )
+				return sysv_hash[1];
+
+			if( gnu_hash == nullptr )
+				return 0;
+
+			const uint32_t bucket_count = gnu_hash[0];
+			const uint32_t symbol_offset = gnu_hash[1];
+			const uint32_t bloom_size = gnu_hash[2];
+			const uint32_t *buckets = reinterpret_cast<const uint32_t *>(
+				reinterpret_cast<const ElfW( Addr ) *>( gnu_hash + 4 ) + bloom_size
+			);
+			const uint32_t *chains = buckets + bucket_count;
+
+			uint32_t last = 0;
+			for( uint32_t k = 0; k < bucket_count; ++k )
+				if( buckets[k] > last )
+					last = buckets[k];
+
+			if( last < symbol_offset )
+				return symbol_offset;
+
+			while( ( chains[last - symbol_offset] & 1 ) == 0 )
+				++last;
+
+			return last + 1;
+		}
+
+		const ElfW( Sym ) *Image::GetSymbol( size_t index ) const
+		{
+			return index < symbol_count ? symbols + index : nullptr;
+		}
+
+		const char *Image::GetSymbolName( const ElfW( Sym ) *symbol ) const
+		{
+			return symbol != nullptr && strings != nullptr ? strings + symbol->st_name : nullptr;
+		}
+
+		const ElfW( Sym ) *Image::FindSymbol( const std::string &symbol_name ) const
+		{
+			if( symbols == nullptr || strings == nullptr || symbol_name.empty( ) )
+				return nullptr;
+
+			const ElfW( Sym ) *symbol = nullptr;
+			if( gnu_hash != nullptr )
+				symbol = FindSymbolGnuHash( symbol_name );
+			else if( sysv_hash != nullptr )
+				symbol = FindSymbolSysvHash( symbol_name );
+
+			return symbol;
+		}
+
+		void *Image::FindSymbolAddress( const std::string &symbol_name ) const
+		{
+			const ElfW( Sym ) *symbol = FindSymbol( symbol_name );
+			if( symbol == nullptr )
+				return nullptr;
+
+			// The symbol points to the resolver, not to the implementation it picked
+			if( DETOURING_ST_TYPE( symbol->st_info ) == STT_GNU_IFUNC )
+				return ResolveIndirectFunction( symbol );
+
+			return reinterpret_cast<void *>( base + symbol->st_value );
+		}
+
+		std::vector<void **> Image::FindImportSlots( const std::string &symbol ) const
+		{
+			std::vector<void **> slots;
+			if( symbols == nullptr || strings == nullptr || symbol.empty( ) )
+				return slots;
+
+			if( plt_relocations_rela )
+				FindImportSlots(
+					static_cast<const ElfW( Rela ) *>( plt_relocations ),
+					plt_relocations_size,
+					symbol,
+					slots
+				);
+			else
+				FindImportSlots(
+					static_cast<const ElfW( Rel ) *>( plt_relocations ),
+					plt_relocations_size,
+					symbol,
+					slots
+				);
+
+			FindImportSlots( rela_relocations, rela_relocations_size, symbol, slots );
+			FindImportSlots( rel_relocations, rel_relocations_size, symbol, slots );
+			return slots;
+		}
+
+		template<typename Relocation>
+		void Image::FindImportSlots(
+			const Relocation *relocations,
+			size_t size,
+			const std::string &symbol,
+			std::vector<void **> &slots
+		) const
+		{
+			if( relocations == nullptr )
+				return;
+
+			const size_t count = size / sizeof( Relocation );
+			for( size_t k = 0; k < count; ++k )
+			{
+				const Relocation &relocation = relocations[k];
+				const auto type = DETOURING_R_TYPE( relocation.r_info );
+				if( type != DETOURING_R_JUMP_SLOT && type != DETOURING_R_GLOB_DAT )
+					continue;
+
+				const ElfW( Sym ) &entry = symbols[DETOURING_R_SYM( relocation.r_info )];
+				if( symbol != strings + entry.st_name )
+					continue;
+
+				void **slot = reinterpret_cast<void **>( base + relocation.r_offset );
+				bool duplicate = false;
+				for( void **existing : slots )
+					if( existing == slot )
+					{
+						duplicate = true;
+						break;
+					}
+
+				if( !duplicate )
+					slots.push_back( slot );
+			}
+		}
+
+		uintptr_t Image::GetGlobalOffsetTable( ) const
+		{
+			return global_offset_table;
+		}
+
+		void *Image::ResolveIndirectFunction( const ElfW( Sym ) *symbol ) const
+		{
+			const char *symbol_name = GetSymbolName( symbol );
+
+			// The dynamic linker calls the resolver and hands us whatever it picked, same as it did for the imports
+			void *handle = name.empty( ) ?
+				dlopen( nullptr, RTLD_LAZY ) :
+				dlopen( name.c_str( ), RTLD_LAZY | RTLD_NOLOAD );
+			if( handle != nullptr )
+			{
+				void *address = dlsym( handle, symbol_name );
+				dlclose( handle );
+				if( address != nullptr )
+					return address;
+			}
+
+			// Local indirect functions are only reachable through their IRELATIVE relocations
+			const ElfW( Rela ) *relocation_lists[] = {
+				plt_relocations_rela ? static_cast<const ElfW( Rela ) *>( plt_relocations ) : nullptr,
+				rela_relocations
+			};
+			const size_t relocation_sizes[] = { plt_relocations_size, rela_relocations_size };
+			for( size_t list = 0; list < 2; ++list )
+			{
+				const ElfW( Rela ) *relocations = relocation_lists[list];
+				if( relocations == nullptr )
+					continue;
+
+				const size_t count = relocation_sizes[list] / sizeof( ElfW( Rela ) );
+				for( size_t k = 0; k < count; ++k )
+					if( DETOURING_R_TYPE( relocations[k].r_info ) == DETOURING_R_IRELATIVE &&
+						static_cast<ElfW( Addr )>( relocations[k].r_addend ) == symbol->st_value )
+						return *reinterpret_cast<void **>( base + relocations[k].r_offset );
+			}
+
+			return nullptr;
+		}
+
+		// Same as the dynamic linker, unversioned lookups skip the hidden (compatibility) versions
+		bool Image::IsDefaultSymbol( size_t index ) const
+		{
+			return versions == nullptr || ( versions[index] & 0x8000 ) == 0;
+		}
+
+		const ElfW( Sym ) *Image::FindSymbolGnuHash( const std::string &symbol_name ) const
+		{
+			constexpr uint32_t bloom_bits = sizeof( ElfW( Addr ) ) * 8;
+
+			const uint32_t bucket_count = gnu_hash[0];
+			const uint32_t symbol_offset = gnu_hash[1];
+			const uint32_t bloom_size = gnu_hash[2];
+			const uint32_t bloom_shift = gnu_hash[3];
+			const ElfW( Addr ) *bloom = reinterpret_cast<const ElfW( Addr ) *>( gnu_hash + 4 );
+			const uint32_t *buckets = reinterpret_cast<const uint32_t *>( bloom + bloom_size );
+			const uint32_t *chains = buckets + bucket_count;
+			if( bucket_count == 0 || bloom_size == 0 )
+				return nullptr;
+
+			const uint32_t hash = GnuHash( symbol_name.c_str( ) );
+			const ElfW( Addr ) word = bloom[( hash / bloom_bits ) % bloom_size];
+			const ElfW( Addr ) mask =
+				( static_cast<ElfW( Addr )>( 1 ) << ( hash % bloom_bits ) ) |
+				( static_cast<ElfW( Addr )>( 1 ) << ( ( hash >> bloom_shift ) % bloom_bits ) );
+			if( ( word & mask ) != mask )
+				return nullptr;
+
+			uint32_t index = buckets[hash % bucket_count];
+			if( index < symbol_offset )
+				return nullptr;
+
+			for( ; ; ++index )
+			{
+				const uint32_t chain_hash = chains[index - symbol_offset];
+				const ElfW( Sym ) *symbol = symbols + index;
+				if( ( hash | 1 ) == ( chain_hash | 1 ) &&
+					symbol->st_shndx != SHN_UNDEF &&
+					IsDefaultSymbol( index ) &&
+					symbol_name == strings + symbol->st_name )
+					return symbol;
+
+				if( ( chain_hash & 1 ) != 0 )
+					break;
+			}
+
+			return nullptr;
+		}
+
+		const ElfW( Sym ) *Image::FindSymbolSysvHash( const std::string &symbol_name ) const
+		{
+			const uint32_t bucket_count = sysv_hash[0];
+			const uint32_t *buckets = sysv_hash + 2;
+			const uint32_t *chains = buckets + bucket_count;
+			if( bucket_count == 0 )
+				return nullptr;
+
+			const uint32_t hash = SysvHash( symbol_name.c_str( ) );
+			for( uint32_t index = buckets[hash % bucket_count]; index != STN_UNDEF; index = chains[index] )
+			{
+				const ElfW( Sym ) *symbol = symbols + index;
+				if( symbol->st_shndx != SHN_UNDEF &&
+					IsDefaultSymbol( index ) &&
+					symbol_name == strings + symbol->st_name )
+					return symbol;
+			}
+
+			return nullptr;
+		}
+	}
+}
+
+#endif
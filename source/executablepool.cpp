@@ -0,0 +1,152 @@
+/*************************************************************************
+* Detouring::ExecutablePool
+* Pool of small executable blocks for gates, relays and thunks.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "helpers.hpp"
+#include "platform.hpp"
+
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+namespace Detouring
+{
+	// Chunks stay RWX, blocks are filled in by their owners after allocation while neighbours
+	// in the same pages may already be running, so there's no point where they could flip to RX
+	// Blocks are 16 byte aligned, a cache line holds up to four of them
+	static constexpr size_t block_alignment = 16;
+	static constexpr size_t chunk_size = 64 * 1024;
+	static constexpr size_t max_block_size = 1024;
+
+	struct ExecutableChunk
+	{
+		uint8_t *base;
+		size_t used;
+	};
+
+	struct ExecutablePool
+	{
+		std::mutex mutex;
+		std::vector<ExecutableChunk> chunks;
+		std::vector<void *> free_blocks[max_block_size / block_alignment];
+	};
+
+	static ExecutablePool &GetExecutablePool( )
+	{
+		// Never destroyed, generated code may still run during static destruction
+		static ExecutablePool *pool = new ExecutablePool;
+		return *pool;
+	}
+
+	static bool IsWithinReach( const void *nearby, const void *address, size_t size )
+	{
+
+#if defined ARCHITECTURE_X86_64
+
+		if( nearby == nullptr )
+			return true;
+
+		const intptr_t limit = INT32_MAX;
+		const intptr_t from = reinterpret_cast<intptr_t>( nearby );
+		const intptr_t first = reinterpret_cast<intptr_t>( address );
+		const intptr_t last = first + static_cast<intptr_t>( size );
+		return first - from < limit && from - first < limit && last - from < limit && from - last < limit;
+
+#else
+
+		(void)nearby;
+		(void)address;
+		(void)size;
+		return true;
+
+#endif
+
+	}
+
+	void *AllocateExecutableBlock( size_t size, void *nearby )
+	{
+		if( size == 0 )
+			return nullptr;
+
+		size = ( size + block_alignment - 1 ) & ~( block_alignment - 1 );
+		if( size > max_block_size )
+			return AllocateExecutableMemory( size, nearby );
+
+		ExecutablePool &pool = GetExecutablePool( );
+		std::lock_guard<std::mutex> lock( pool.mutex );
+
+		std::vector<void *> &free_blocks = pool.free_blocks[size / block_alignment - 1];
+		for( auto it = free_blocks.rbegin( ); it != free_blocks.rend( ); ++it )
+			if( IsWithinReach( nearby, *it, size ) )
+			{
+				void *block = *it;
+				free_blocks.erase( std::next( it ).base( ) );
+				return block;
+			}
+
+		for( ExecutableChunk &chunk : pool.chunks )
+		{
+			uint8_t *block = chunk.base + chunk.used;
+			if( chunk.used + size <= chunk_size && IsWithinReach( nearby, block, size ) )
+			{
+				chunk.used += size;
+				return block;
+			}
+		}
+
+		uint8_t *base = static_cast<uint8_t *>( AllocateExecutableMemory( chunk_size, nearby ) );
+		if( base == nullptr )
+			return nullptr;
+
+		pool.chunks.push_back( { base, size } );
+		return base;
+	}
+
+	bool FreeExecutableBlock( void *address, size_t size )
+	{
+		if( address == nullptr || size == 0 )
+			return false;
+
+		size = ( size + block_alignment - 1 ) & ~( block_alignment - 1 );
+		if( size > max_block_size )
+			return FreeExecutableMemory( address, size );
+
+		// Chunks are kept for the lifetime of the process, their blocks get reused
+		ExecutablePool &pool = GetExecutablePool( );
+		std::lock_guard<std::mutex> lock( pool.mutex );
+		pool.free_blocks[size / block_alignment - 1].push_back( address );
+		return true;
+	}
+}
@@ -36,8 +36,29 @@
 #include "helpers.hpp"
 #include "platform.hpp"
 #include "MinHook.h"
+#include "disassembler.hpp"
 #include <stdexcept>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#if defined COMPILER_VC
+
+#include <intrin.h>
+
+#define DETOURING_TARGET_SSE2
+#define DETOURING_TARGET_AVX2
+
+#else
+
+// x86 builds don't enable SSE2 by default, the kernels are only reached after checking for it
+#define DETOURING_TARGET_SSE2 __attribute__( ( target( "sse2" ) ) )
+#define DETOURING_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+
+#endif
+
+#include <immintrin.h>
 
 #if defined SYSTEM_WINDOWS
 
@@ -50,8 +71,16 @@
 
 #elif defined SYSTEM_LINUX
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
+#include "elf.hpp"
+
 #include <sys/mman.h>
 #include <unistd.h>
+#include <dlfcn.h>
+#include <link.h>
 #include <cstdio>
 #include <cinttypes>
 
@@ -66,6 +95,240 @@
 
 namespace Detouring
 {
+	uintptr_t GetPageSize( )
+	{
+
+#if defined SYSTEM_WINDOWS
+
+		SYSTEM_INFO info = { 0 };
+		GetSystemInfo( &info );
+		return static_cast<uintptr_t>( info.dwPageSize );
+
+#else
+
+		return static_cast<uintptr_t>( sysconf( _SC_PAGESIZE ) );
+
+#endif
+
+	}
+
+	static bool WritePointerRun(
+		uintptr_t start,
+		uintptr_t end,
+		const PointerPatch *const *patches,
+		size_t count
+	)
+	{
+		void *address = reinterpret_cast<void *>( start );
+		const size_t length = static_cast<size_t>( end - start );
+		const int32_t protection = GetMemoryProtection( address, length );
+		if( protection < MemoryProtection::None )
+		{
+			if( count == 1 )
+				return false;
+
+			// The run crosses mappings with different protections, do it the slow way
+			bool success = true;
+			for( size_t k = 0; k < count; ++k )
+			{
+				const uintptr_t slot = reinterpret_cast<uintptr_t>( patches[k]->slot );
+				if( !WritePointerRun( slot, slot + sizeof( void * ), patches + k, 1 ) )
+					success = false;
+			}
+
+			return success;
+		}
+
+		if( ( protection & MemoryProtection::Write ) == 0 &&
+			!SetMemoryProtection( address, length, protection | MemoryProtection::Write ) )
+			return false;
+
+		for( size_t k = 0; k < count; ++k )
+			StorePointer( patches[k]->slot, patches[k]->value );
+
+		if( ( protection & MemoryProtection::Write ) == 0 )
+			SetMemoryProtection( address, length, protection );
+
+		return true;
+	}
+
+#if defined SYSTEM_LINUX && defined ARCHITECTURE_X86_64
+
+	static uintptr_t FindFreeRegion( uintptr_t nearby, size_t size )
+	{
+		FILE *file = fopen( "/proc/self/maps", "r" );
+		if( file == nullptr )
+			return 0;
+
+		const uintptr_t page_mask = ~( GetPageSize( ) - 1 );
+		const uintptr_t limit = 0x7FFF0000;
+		uintptr_t previous_end = 0x10000, best = 0, best_distance = limit;
+		char line[BUFSIZ] = { 0 };
+		while( fgets( line, sizeof( line ), file ) != nullptr )
+		{
+			uint64_t start = 0, end = 0;
+			if( sscanf( line, "%" SCNx64 "-%" SCNx64, &start, &end ) != 2 )
+				continue;
+
+			if( start > previous_end && start - previous_end >= size )
+			{
+				uintptr_t candidate = nearby & page_mask;
+				if( candidate < previous_end )
+					candidate = previous_end;
+				else if( candidate + size > start )
+					candidate = ( start - size ) & page_mask;
+
+				const uintptr_t distance = candidate > nearby ? candidate - nearby : nearby - candidate;
+				if( distance < best_distance )
+				{
+					best = candidate;
+					best_distance = distance;
+				}
+			}
+
+			if( end > previous_end )
+				previous_end = static_cast<uintptr_t>( end );
+		}
+
+		fclose( file );
+		return best;
+	}
+
+#elif defined SYSTEM_WINDOWS && defined ARCHITECTURE_X86_64
+
+	static void *AllocateNear( uintptr_t nearby, size_t size )
+	{
+		SYSTEM_INFO info = { 0 };
+		GetSystemInfo( &info );
+		const uintptr_t granularity = static_cast<uintptr_t>( info.dwAllocationGranularity );
+		const uintptr_t limit = 0x7FFF0000;
+		const uintptr_t minimum = nearby > limit ? nearby - limit : granularity;
+		const uintptr_t maximum = nearby + limit;
+
+		for( uintptr_t address = nearby - nearby % granularity; address > minimum; address -= granularity )
+		{
+			MEMORY_BASIC_INFORMATION mi = { 0 };
+			if( VirtualQuery( reinterpret_cast<void *>( address ), &mi, sizeof( mi ) ) == 0 )
+				break;
+
+			if( mi.State != MEM_FREE )
+			{
+				address = reinterpret_cast<uintptr_t>( mi.AllocationBase );
+				address -= address % granularity;
+				continue;
+			}
+
+			void *memory = VirtualAlloc(
+				reinterpret_cast<void *>( address ),
+				size,
+				MEM_COMMIT | MEM_RESERVE,
+				PAGE_EXECUTE_READWRITE
+			);
+			if( memory != nullptr )
+				return memory;
+		}
+
+		for( uintptr_t address = nearby - nearby % granularity + granularity; address < maximum; address += granularity )
+		{
+			MEMORY_BASIC_INFORMATION mi = { 0 };
+			if( VirtualQuery( reinterpret_cast<void *>( address ), &mi, sizeof( mi ) ) == 0 )
+				break;
+
+			if( mi.State != MEM_FREE )
+			{
+				address = reinterpret_cast<uintptr_t>( mi.BaseAddress ) + mi.RegionSize;
+				address -= address % granularity;
+				continue;
+			}
+
+			void *memory = VirtualAlloc(
+				reinterpret_cast<void *>( address ),
+				size,
+				MEM_COMMIT | MEM_RESERVE,
+				PAGE_EXECUTE_READWRITE
+			);
+			if( memory != nullptr )
+				return memory;
+		}
+
+		return nullptr;
+	}
+
+#endif
+
+	static bool IsBranchTargetMarker( const uint8_t *code )
+	{
+		// endbr64/endbr32
+		return code[0] == 0xF3 && code[1] == 0x0F && code[2] == 0x1E && ( code[3] & 0xFE ) == 0xFA;
+	}
+
+	bool IsLazyBindingStub( const void *address )
+	{
+		const uint8_t *code = static_cast<const uint8_t *>( address );
+		if( IsBranchTargetMarker( code ) )
+			code += 4;
+
+		return code[0] == 0x68;
+	}
+
+#if defined SYSTEM_WINDOWS
+
+	// Incremental linking tables are runs of jmp rel32 thunks, a lone one is most likely a tail call
+	static bool IsIncrementalLinkThunk( const uint8_t *code )
+	{
+		const uint8_t *page = reinterpret_cast<const uint8_t *>(
+			reinterpret_cast<uintptr_t>( code ) & ~static_cast<uintptr_t>( GetPageSize( ) - 1 )
+		);
+		return code[5] == 0xE9 || ( code - 5 >= page && code[-5] == 0xE9 );
+	}
+
+#endif
+
+	// Only follows import and linker stubs, jumps in regular code are tail calls into other functions
+	static uint8_t *GetJumpDestination( uint8_t *code )
+	{
+		InstructionInfo info;
+		const unsigned int length = Disassemble( code, info );
+		if( length == 0 || ( info.flags & F_ERROR ) != 0 || info.p_66 != 0 )
+			return nullptr;
+
+#if defined SYSTEM_WINDOWS
+
+		// jmp rel32
+		if( info.opcode == 0xE9 && IsIncrementalLinkThunk( code ) )
+		{
+			uint8_t *next = code + length;
+			int32_t displacement = 0;
+			std::memcpy( &displacement, next - 4, sizeof( displacement ) );
+			return next + displacement;
+		}
+
+#endif
+
+		// jmp [rip + disp32] on x86-64, jmp [disp32] on x86
+		if( info.opcode == 0xFF && info.modrm_reg == 4 && info.modrm_mod == 0 && info.modrm_rm == 5 )
+		{
+
+#ifdef ARCHITECTURE_X86_64
+
+			uint8_t **slot = reinterpret_cast<uint8_t **>( code + length + static_cast<int32_t>( info.disp.disp32 ) );
+
+#else
+
+			uint8_t **slot = reinterpret_cast<uint8_t **>( static_cast<uintptr_t>( info.disp.disp32 ) );
+
+#endif
+
+			uint8_t *destination = *slot;
+			if( destination == nullptr || IsLazyBindingStub( destination ) )
+				return nullptr;
+
+			return destination;
+		}
+
+		return nullptr;
+	}
+
 	Member::Member( )
 	{
 		address = nullptr;
@@ -78,6 +341,76 @@ namespace Detouring
 		index = idx;
 	}
 
+	// Bounds offsets to top and virtual base and call offsets, any mapped address is far beyond it
+	static constexpr intptr_t max_virtual_table_offset = 0x100000;
+
+#if defined SYSTEM_LINUX
+
+	// The _ZTV symbol spans the primary virtual table and every secondary one that follows it
+	static bool GetVirtualTableSymbol( void **vtable, void **&start, void **&end )
+	{
+		Dl_info info = { };
+		void *entry = nullptr;
+		if(
+			dladdr1( vtable, &info, &entry, RTLD_DL_SYMENT ) == 0 ||
+			entry == nullptr || info.dli_sname == nullptr || std::strncmp( info.dli_sname, "_ZTV", 4 ) != 0
+		)
+			return false;
+
+		const ElfW( Sym ) *symbol = static_cast<const ElfW( Sym ) *>( entry );
+		start = static_cast<void **>( info.dli_saddr );
+		end = reinterpret_cast<void **>( reinterpret_cast<uintptr_t>( start ) + symbol->st_size );
+		return vtable >= start + 2 && vtable < end;
+	}
+
+	static size_t GetVirtualTableSizeFromSymbol( void **vtable )
+	{
+		void **start = nullptr, **end = nullptr;
+		if( !GetVirtualTableSymbol( vtable, start, end ) )
+			return 0;
+
+		// Secondary tables start with their offsets followed by the same type info pointer
+		void *typeinfo = vtable[-1];
+		size_t count = static_cast<size_t>( end - vtable );
+		for( size_t k = 0; k + 1 < count; ++k )
+			if( vtable[k + 1] == typeinfo && IsVirtualTableOffset( vtable[k] ) )
+			{
+				count = k;
+				while( count != 0 && IsVirtualTableOffset( vtable[count - 1] ) )
+					--count;
+
+				break;
+			}
+
+		return count;
+	}
+
+	// Checks entries against the loaded executable segments instead of querying each one
+	static size_t GetVirtualTableSizeFromSegments( void **vtable )
+	{
+		std::vector<Elf::Segment> segments;
+		for( const Elf::Image &image : Elf::Image::GetLoaded( ) )
+			for( const Elf::Segment &segment : image.GetSegments( ) )
+				if( ( segment.protection & MemoryProtection::Execute ) != 0 )
+					segments.push_back( segment );
+
+		size_t count = 0;
+		for( ; vtable[count] != nullptr; ++count )
+		{
+			const uintptr_t entry = reinterpret_cast<uintptr_t>( vtable[count] );
+			const auto it = std::find_if( segments.begin( ), segments.end( ), [entry]( const Elf::Segment &segment )
+			{
+				return entry >= segment.start && entry - segment.start < segment.size;
+			} );
+			if( it == segments.end( ) )
+				break;
+		}
+
+		return count;
+	}
+
+#endif
+
 	bool Member::IsValid( ) const
 	{
 		return address != nullptr;
@@ -175,7 +508,7 @@ namespace Detouring
 			char prot[5] = { 0 };
 			if( sscanf( line, "%" SCNx64 "-%" SCNx64 " %4[rwxsp-]", &start, &end, prot ) == 3 &&
 				start <= _address &&
-				end >= _address )
+				end > _address )
 			{
 				fclose( file );
 
@@ -202,6 +535,27 @@ namespace Detouring
 
 	}
 
+	int32_t GetMemoryProtection( void *address, size_t length )
+	{
+		if( address == nullptr || length == 0 )
+			return MemoryProtection::Error;
+
+		const uintptr_t page_size = GetPageSize( );
+		const uintptr_t page_mask = ~( page_size - 1 );
+		const uintptr_t first = reinterpret_cast<uintptr_t>( address ) & page_mask;
+		const uintptr_t last = reinterpret_cast<uintptr_t>( address ) + length;
+
+		const int32_t protection = GetMemoryProtection( reinterpret_cast<void *>( first ) );
+		if( protection < MemoryProtection::None )
+			return MemoryProtection::Error;
+
+		for( uintptr_t page = first + page_size; page < last; page += page_size )
+			if( GetMemoryProtection( reinterpret_cast<void *>( page ) ) != protection )
+				return MemoryProtection::Error;
+
+		return protection;
+	}
+
 	bool SetMemoryProtection(
 		void *address,
 		size_t length,
@@ -308,4 +662,541 @@ namespace Detouring
 	{
 		return ( GetMemoryProtection( address ) & MemoryProtection::Execute ) != 0;
 	}
+
+	static bool IsSse2Supported( )
+	{
+
+#if defined ARCHITECTURE_X86_64
+
+		return true;
+
+#elif defined COMPILER_VC
+
+		int info[4] = { };
+		__cpuid( info, 1 );
+		return ( info[3] & ( 1 << 26 ) ) != 0;
+
+#else
+
+		__builtin_cpu_init( );
+		return __builtin_cpu_supports( "sse2" ) != 0;
+
+#endif
+
+	}
+
+	static bool IsAvx2Supported( )
+	{
+
+#if defined COMPILER_VC
+
+		int info[4] = { };
+		__cpuid( info, 0 );
+		if( info[0] < 7 )
+			return false;
+
+		// The OS must save the upper halves of the YMM registers
+		__cpuid( info, 1 );
+		if( ( info[2] & ( 1 << 27 ) ) == 0 || ( info[2] & ( 1 << 28 ) ) == 0 || ( _xgetbv( 0 ) & 6 ) != 6 )
+			return false;
+
+		__cpuidex( info, 7, 0 );
+		return ( info[1] & ( 1 << 5 ) ) != 0;
+
+#else
+
+		__builtin_cpu_init( );
+		return __builtin_cpu_supports( "avx2" ) != 0;
+
+#endif
+
+	}
+
+	// Bit k of the masks is set when pointer k of the block matched
+#ifdef ARCHITECTURE_X86_64
+
+	static constexpr size_t sse2_lanes = 2;
+	static constexpr size_t avx2_lanes = 4;
+
+	DETOURING_TARGET_SSE2 static inline int CompareSse2( const void *first, const void *second )
+	{
+		const __m128i a = _mm_loadu_si128( static_cast<const __m128i *>( first ) );
+		const __m128i b = _mm_loadu_si128( static_cast<const __m128i *>( second ) );
+
+		// No 64-bit compare in SSE2, both halves must match
+		__m128i equal = _mm_cmpeq_epi32( a, b );
+		equal = _mm_and_si128( equal, _mm_shuffle_epi32( equal, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+		return _mm_movemask_pd( _mm_castsi128_pd( equal ) );
+	}
+
+	DETOURING_TARGET_SSE2 static inline int MatchSse2( const void *first, const void *value )
+	{
+		const __m128i b = _mm_set1_epi64x( static_cast<long long>( reinterpret_cast<uintptr_t>( value ) ) );
+		__m128i equal = _mm_cmpeq_epi32( _mm_loadu_si128( static_cast<const __m128i *>( first ) ), b );
+		equal = _mm_and_si128( equal, _mm_shuffle_epi32( equal, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+		return _mm_movemask_pd( _mm_castsi128_pd( equal ) );
+	}
+
+	DETOURING_TARGET_AVX2 static inline int CompareAvx2( const __m256i &a, const __m256i &b )
+	{
+		return _mm256_movemask_pd( _mm256_castsi256_pd( _mm256_cmpeq_epi64( a, b ) ) );
+	}
+
+	DETOURING_TARGET_AVX2 static inline __m256i BroadcastAvx2( const void *value )
+	{
+		return _mm256_set1_epi64x( static_cast<long long>( reinterpret_cast<uintptr_t>( value ) ) );
+	}
+
+#else
+
+	static constexpr size_t sse2_lanes = 4;
+	static constexpr size_t avx2_lanes = 8;
+
+	DETOURING_TARGET_SSE2 static inline int CompareSse2( const void *first, const void *second )
+	{
+		const __m128i a = _mm_loadu_si128( static_cast<const __m128i *>( first ) );
+		const __m128i b = _mm_loadu_si128( static_cast<const __m128i *>( second ) );
+		return _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( a, b ) ) );
+	}
+
+	DETOURING_TARGET_SSE2 static inline int MatchSse2( const void *first, const void *value )
+	{
+		const __m128i b = _mm_set1_epi32( static_cast<int>( reinterpret_cast<uintptr_t>( value ) ) );
+		const __m128i equal = _mm_cmpeq_epi32( _mm_loadu_si128( static_cast<const __m128i *>( first ) ), b );
+		return _mm_movemask_ps( _mm_castsi128_ps( equal ) );
+	}
+
+	DETOURING_TARGET_AVX2 static inline int CompareAvx2( const __m256i &a, const __m256i &b )
+	{
+		return _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpeq_epi32( a, b ) ) );
+	}
+
+	DETOURING_TARGET_AVX2 static inline __m256i BroadcastAvx2( const void *value )
+	{
+		return _mm256_set1_epi32( static_cast<int>( reinterpret_cast<uintptr_t>( value ) ) );
+	}
+
+#endif
+
+	static constexpr int sse2_all = ( 1 << sse2_lanes ) - 1;
+	static constexpr int avx2_all = ( 1 << avx2_lanes ) - 1;
+
+	static inline size_t LowestBit( unsigned int mask )
+	{
+
+#if defined COMPILER_VC
+
+		unsigned long index = 0;
+		_BitScanForward( &index, mask );
+		return index;
+
+#else
+
+		return static_cast<size_t>( __builtin_ctz( mask ) );
+
+#endif
+
+	}
+
+	static size_t FindPointerScalar( void *const *pointers, size_t count, const void *value )
+	{
+		for( size_t k = 0; k < count; ++k )
+			if( pointers[k] == value )
+				return k;
+
+		return count;
+	}
+
+	DETOURING_TARGET_SSE2 static size_t FindPointerSse2( void *const *pointers, size_t count, const void *value )
+	{
+		size_t k = 0;
+		for( ; k + sse2_lanes <= count; k += sse2_lanes )
+		{
+			const int mask = MatchSse2( pointers + k, value );
+			if( mask != 0 )
+				return k + LowestBit( static_cast<unsigned int>( mask ) );
+		}
+
+		return k + FindPointerScalar( pointers + k, count - k, value );
+	}
+
+	DETOURING_TARGET_AVX2 static size_t FindPointerAvx2( void *const *pointers, size_t count, const void *value )
+	{
+		const __m256i broadcast = BroadcastAvx2( value );
+		size_t k = 0;
+		for( ; k + avx2_lanes <= count; k += avx2_lanes )
+		{
+			const __m256i block = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( pointers + k ) );
+			const int mask = CompareAvx2( block, broadcast );
+			if( mask != 0 )
+				return k + LowestBit( static_cast<unsigned int>( mask ) );
+		}
+
+		const size_t rest = FindPointerSse2( pointers + k, count - k, value );
+		return k + rest;
+	}
+
+	static size_t FindPointerMismatchScalar( void *const *first, void *const *second, size_t count )
+	{
+		for( size_t k = 0; k < count; ++k )
+			if( first[k] != second[k] )
+				return k;
+
+		return count;
+	}
+
+	DETOURING_TARGET_SSE2 static size_t FindPointerMismatchSse2( void *const *first, void *const *second, size_t count )
+	{
+		size_t k = 0;
+		for( ; k + sse2_lanes <= count; k += sse2_lanes )
+		{
+			const int mask = CompareSse2( first + k, second + k );
+			if( mask != sse2_all )
+				return k + LowestBit( static_cast<unsigned int>( ~mask & sse2_all ) );
+		}
+
+		return k + FindPointerMismatchScalar( first + k, second + k, count - k );
+	}
+
+	DETOURING_TARGET_AVX2 static size_t FindPointerMismatchAvx2( void *const *first, void *const *second, size_t count )
+	{
+		size_t k = 0;
+		for( ; k + avx2_lanes <= count; k += avx2_lanes )
+		{
+			const __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( first + k ) );
+			const __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( second + k ) );
+			const int mask = CompareAvx2( a, b );
+			if( mask != avx2_all )
+				return k + LowestBit( static_cast<unsigned int>( ~mask & avx2_all ) );
+		}
+
+		return k + FindPointerMismatchSse2( first + k, second + k, count - k );
+	}
+
+	enum class VectorLevel
+	{
+		Scalar,
+		Sse2,
+		Avx2
+	};
+
+	static VectorLevel GetVectorLevel( )
+	{
+		static const VectorLevel level = IsAvx2Supported( ) ?
+			VectorLevel::Avx2 :
+			( IsSse2Supported( ) ? VectorLevel::Sse2 : VectorLevel::Scalar );
+		return level;
+	}
+
+	size_t FindPointer( void *const *pointers, size_t count, const void *value )
+	{
+		if( pointers == nullptr )
+			return count;
+
+		switch( GetVectorLevel( ) )
+		{
+		case VectorLevel::Avx2:
+			return FindPointerAvx2( pointers, count, value );
+
+		case VectorLevel::Sse2:
+			return FindPointerSse2( pointers, count, value );
+
+		default:
+			return FindPointerScalar( pointers, count, value );
+		}
+	}
+
+	size_t FindPointerMismatch( void *const *first, void *const *second, size_t count )
+	{
+		if( first == nullptr || second == nullptr )
+			return 0;
+
+		switch( GetVectorLevel( ) )
+		{
+		case VectorLevel::Avx2:
+			return FindPointerMismatchAvx2( first, second, count );
+
+		case VectorLevel::Sse2:
+			return FindPointerMismatchSse2( first, second, count );
+
+		default:
+			return FindPointerMismatchScalar( first, second, count );
+		}
+	}
+
+	size_t GetVirtualTableSize( void **vtable )
+	{
+		if( vtable == nullptr )
+			return 0;
+
+#if defined SYSTEM_LINUX
+
+		const size_t size = GetVirtualTableSizeFromSymbol( vtable );
+		if( size != 0 )
+			return size;
+
+		return GetVirtualTableSizeFromSegments( vtable );
+
+#else
+
+		size_t size = 0;
+		while( vtable[size] != nullptr && IsExecutableAddress( vtable[size] ) )
+			++size;
+
+		return size;
+
+#endif
+
+	}
+
+	bool IsVirtualTableOffset( const void *entry )
+	{
+		const intptr_t value = reinterpret_cast<intptr_t>( entry );
+		return value > -max_virtual_table_offset && value < max_virtual_table_offset;
+	}
+
+	size_t GetVirtualTablePrefixSize( void **vtable )
+	{
+		if( vtable == nullptr )
+			return 0;
+
+#if defined COMPILER_VC
+
+		// Complete object locator
+		return 1;
+
+#else
+
+#if defined SYSTEM_LINUX
+
+		void **start = nullptr, **end = nullptr;
+		if( GetVirtualTableSymbol( vtable, start, end ) )
+			return static_cast<size_t>( vtable - start );
+
+#endif
+
+		// Type info and offset to top, then any virtual call and base offsets before them
+		const uintptr_t page_mask = ~( GetPageSize( ) - 1 );
+		void **entry = vtable - 2;
+		for( size_t k = 0; k < 64; ++k )
+		{
+			void **previous = entry - 1;
+			if( ( reinterpret_cast<uintptr_t>( previous ) & page_mask ) != ( reinterpret_cast<uintptr_t>( entry ) & page_mask ) )
+			{
+				const int32_t protection = GetMemoryProtection( previous );
+				if( protection < MemoryProtection::None || ( protection & MemoryProtection::Read ) == 0 )
+					break;
+			}
+
+			if( !IsVirtualTableOffset( *previous ) )
+				break;
+
+			entry = previous;
+		}
+
+		return static_cast<size_t>( vtable - entry );
+
+#endif
+
+	}
+
+	void *FollowJumps( void *address )
+	{
+		uint8_t *code = static_cast<uint8_t *>( address );
+		for( size_t depth = 0; code != nullptr && depth < 32; ++depth )
+		{
+			uint8_t *destination = GetJumpDestination( IsBranchTargetMarker( code ) ? code + 4 : code );
+			if( destination == nullptr || destination == code )
+				break;
+
+			code = destination;
+		}
+
+		return code;
+	}
+
+	bool WritePointers( const PointerPatch *patches, size_t count )
+	{
+		if( count == 0 )
+			return true;
+
+		if( patches == nullptr )
+			return false;
+
+		std::vector<const PointerPatch *> sorted( count );
+		for( size_t k = 0; k < count; ++k )
+			sorted[k] = patches + k;
+
+		std::sort( sorted.begin( ), sorted.end( ), []( const PointerPatch *a, const PointerPatch *b )
+		{
+			return a->slot < b->slot;
+		} );
+
+		const uintptr_t page_size = GetPageSize( );
+		const uintptr_t page_mask = ~( page_size - 1 );
+		bool success = true;
+		for( size_t first = 0; first < count; )
+		{
+			uintptr_t slot = reinterpret_cast<uintptr_t>( sorted[first]->slot );
+			const uintptr_t start = slot & page_mask;
+			uintptr_t end = ( slot + sizeof( void * ) + page_size - 1 ) & page_mask;
+
+			size_t last = first + 1;
+			for( ; last < count; ++last )
+			{
+				slot = reinterpret_cast<uintptr_t>( sorted[last]->slot );
+				if( ( slot & page_mask ) > end )
+					break;
+
+				end = ( slot + sizeof( void * ) + page_size - 1 ) & page_mask;
+			}
+
+			if( !WritePointerRun( start, end, sorted.data( ) + first, last - first ) )
+				success = false;
+
+			first = last;
+		}
+
+		return success;
+	}
+
+	bool WritePointer( void **slot, void *value )
+	{
+		const PointerPatch patch = { slot, value };
+		return WritePointers( &patch, 1 );
+	}
+
+	static bool IsPointerAligned( void **slot )
+	{
+		return ( reinterpret_cast<uintptr_t>( slot ) & ( sizeof( void * ) - 1 ) ) == 0;
+	}
+
+	void StorePointer( void **slot, void *value )
+	{
+		// Misaligned slots can't be written in one go, they still get a plain store
+
+#if defined COMPILER_VC
+
+		if( IsPointerAligned( slot ) )
+			_InterlockedExchangePointer( slot, value );
+		else
+			*slot = value;
+
+#else
+
+		if( IsPointerAligned( slot ) )
+			__atomic_store_n( slot, value, __ATOMIC_RELEASE );
+		else
+			*slot = value;
+
+#endif
+
+	}
+
+	void *ExchangePointer( void **slot, void *value )
+	{
+		if( slot == nullptr || !IsPointerAligned( slot ) )
+			return nullptr;
+
+#if defined COMPILER_VC
+
+		return _InterlockedExchangePointer( slot, value );
+
+#else
+
+		return __atomic_exchange_n( slot, value, __ATOMIC_ACQ_REL );
+
+#endif
+
+	}
+
+	bool CompareExchangePointer( void **slot, void *&expected, void *desired )
+	{
+		if( slot == nullptr || !IsPointerAligned( slot ) )
+			return false;
+
+#if defined COMPILER_VC
+
+		void *previous = _InterlockedCompareExchangePointer( slot, desired, expected );
+		if( previous == expected )
+			return true;
+
+		expected = previous;
+		return false;
+
+#else
+
+		return __atomic_compare_exchange_n( slot, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+
+#endif
+
+	}
+
+	void *AllocateExecutableMemory( size_t size, void *nearby )
+	{
+		if( size == 0 )
+			return nullptr;
+
+		const uintptr_t page_size = GetPageSize( );
+		size = static_cast<size_t>( ( size + page_size - 1 ) & ~( page_size - 1 ) );
+
+#if defined SYSTEM_WINDOWS
+
+#ifdef ARCHITECTURE_X86_64
+
+		if( nearby != nullptr )
+		{
+			void *memory = AllocateNear( reinterpret_cast<uintptr_t>( nearby ), size );
+			if( memory != nullptr )
+				return memory;
+		}
+
+#endif
+
+		return VirtualAlloc( nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE );
+
+#else
+
+		void *hint = nearby;
+
+#if defined SYSTEM_LINUX && defined ARCHITECTURE_X86_64
+
+		if( nearby != nullptr )
+			hint = reinterpret_cast<void *>( FindFreeRegion( reinterpret_cast<uintptr_t>( nearby ), size ) );
+
+#endif
+
+		void *memory = mmap(
+			hint,
+			size,
+			PROT_READ | PROT_WRITE | PROT_EXEC,
+			MAP_PRIVATE | MAP_ANONYMOUS,
+			-1,
+			0
+		);
+		return memory != MAP_FAILED ? memory : nullptr;
+
+#endif
+
+	}
+
+	bool FreeExecutableMemory( void *address, size_t size )
+	{
+		if( address == nullptr )
+			return false;
+
+#if defined SYSTEM_WINDOWS
+
+		(void)size;
+		return VirtualFree( address, 0, MEM_RELEASE ) != 0;
+
+#else
+
+		const uintptr_t page_size = GetPageSize( );
+		size = static_cast<size_t>( ( size + page_size - 1 ) & ~( page_size - 1 ) );
+		return munmap( address, size ) == 0;
+
+#endif
+
+	}
 }
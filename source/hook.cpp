@@ -36,6 +36,7 @@
 #include "hook.hpp"
 #include "helpers.hpp"
 #include "platform.hpp"
+#include "elf.hpp"
 #include "MinHook.h"
 
 #include <cstring>
@@ -154,15 +155,22 @@ namespace Detouring
 		if( pointer == nullptr )
 			return false;
 
+		pointer = FollowJumps( pointer );
+
+		void *entry = GetEntry( _detour, pointer );
+		if( entry == nullptr )
+			return false;
+
 		MH_Initialize( );
 
-		if( MH_CreateHook( pointer, _detour, &trampoline ) == MH_OK )
+		if( MH_CreateHook( pointer, entry, &trampoline ) == MH_OK )
 		{
 			target = pointer;
 			detour = _detour;
 			return true;
 		}
 
+		profiler.Destroy( );
 		return false;
 	}
 
@@ -180,14 +188,19 @@ namespace Detouring
 		if( _detour == nullptr )
 			return false;
 
+		void *entry = GetEntry( _detour, nullptr );
+		if( entry == nullptr )
+			return false;
+
 		MH_Initialize( );
 
-		if( MH_CreateHookApiEx( module.GetModuleName( ).c_str( ), _target.c_str( ), _detour, &trampoline, &target ) == MH_OK )
+		if( MH_CreateHookApiEx( module.GetModuleName( ).c_str( ), _target.c_str( ), entry, &trampoline, &target ) == MH_OK )
 		{
 			detour = _detour;
 			return true;
 		}
 
+		profiler.Destroy( );
 		return false;
 	}
 
@@ -202,6 +215,7 @@ namespace Detouring
 		target = nullptr;
 		detour = nullptr;
 		trampoline = nullptr;
+		profiler.Destroy( );
 		MH_Uninitialize( );
 		return true;
 	}
@@ -236,6 +250,42 @@ namespace Detouring
 		return trampoline;
 	}
 
+	bool Hook::EnableProfiling( bool measure_cycles )
+	{
+		profiling = true;
+		profile_cycles = measure_cycles && CallProfiler::IsCyclesSupported( );
+		return true;
+	}
+
+	bool Hook::DisableProfiling( )
+	{
+		profiling = false;
+		profile_cycles = false;
+		return true;
+	}
+
+	Hook::Profile Hook::GetProfile( ) const
+	{
+		const CallProfiler::Result result = profiler.GetResult( 0 );
+		return { result.calls, result.cycles };
+	}
+
+	void Hook::ResetProfile( )
+	{
+		profiler.Reset( );
+	}
+
+	void *Hook::GetEntry( void *_detour, void *nearby )
+	{
+		if( !profiling )
+			return _detour;
+
+		if( !profiler.Create( &_detour, 1, profile_cycles, nearby ) )
+			return nullptr;
+
+		return profiler.GetStub( 0 );
+	}
+
 	void *Hook::FindSymbol( const std::string &symbol )
 	{
 
@@ -265,6 +315,22 @@ namespace Detouring
 
 		return nullptr;
 
+#elif defined SYSTEM_LINUX
+
+		void *pointer = dlsym( RTLD_DEFAULT, symbol.c_str( ) );
+		if( pointer != nullptr )
+			return pointer;
+
+		// Modules loaded with RTLD_LOCAL are invisible to RTLD_DEFAULT
+		for( const Elf::Image &image : Elf::Image::GetLoaded( ) )
+		{
+			pointer = image.FindSymbolAddress( symbol );
+			if( pointer != nullptr )
+				return pointer;
+		}
+
+		return nullptr;
+
 #elif defined SYSTEM_POSIX
 
 		return dlsym( RTLD_DEFAULT, symbol.c_str( ) );
@@ -0,0 +1,467 @@
+/*************************************************************************
+* Detouring::ImportHook
+* A C++ class that allows you to redirect the imports of a module.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "importhook.hpp"
+#include "helpers.hpp"
+#include "platform.hpp"
+#include "elf.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <algorithm>
+
+#if defined SYSTEM_LINUX
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
+#include <dlfcn.h>
+
+#endif
+
+namespace Detouring
+{
+	ImportHook::ImportHook( void **slot, void *_detour )
+	{
+		Create( slot, _detour );
+	}
+
+	ImportHook::ImportHook( const Hook::Module &module, const std::string &_target, void *_detour )
+	{
+		Create( module, _target, _detour );
+	}
+
+	ImportHook::~ImportHook( )
+	{
+		Destroy( );
+	}
+
+	bool ImportHook::IsValid( ) const
+	{
+		return !slots.empty( ) && target != nullptr && detour != nullptr;
+	}
+
+	bool ImportHook::Create( void **slot, void *_detour )
+	{
+		if( IsValid( ) || slot == nullptr || *slot == nullptr || _detour == nullptr )
+			return false;
+
+		target = *slot;
+		detour = _detour;
+		slots.push_back( { slot, target } );
+		return true;
+	}
+
+	bool ImportHook::Create( const Hook::Module &module, const std::string &_target, void *_detour )
+	{
+		if( IsValid( ) || !module.IsValid( ) || _target.empty( ) || _detour == nullptr )
+			return false;
+
+#if defined SYSTEM_LINUX
+
+		const Elf::Image image = Elf::Image::FromModule( module );
+		if( !image.IsValid( ) )
+			return false;
+
+		const std::vector<void **> addresses = image.FindImportSlots( _target );
+		if( addresses.empty( ) )
+			return false;
+
+		void *original = *addresses.front( );
+		if( original == nullptr || ( image.Contains( original ) && IsLazyBindingStub( original ) ) )
+			original = dlsym( RTLD_DEFAULT, _target.c_str( ) );
+
+		if( original == nullptr )
+			return false;
+
+		for( void **address : addresses )
+			slots.push_back( { address, *address } );
+
+		target = original;
+		detour = _detour;
+		return true;
+
+#else
+
+		return false;
+
+#endif
+
+	}
+
+	bool ImportHook::Destroy( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		Disable( );
+
+		slots.clear( );
+		target = nullptr;
+		detour = nullptr;
+		return true;
+	}
+
+	bool ImportHook::IsEnabled( ) const
+	{
+		if( !IsValid( ) )
+			return false;
+
+		for( const Slot &slot : slots )
+			if( *slot.address == detour )
+				return true;
+
+		return false;
+	}
+
+	bool ImportHook::Enable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		std::vector<PointerPatch> patches;
+		patches.reserve( slots.size( ) );
+		for( const Slot &slot : slots )
+			patches.push_back( { slot.address, detour } );
+
+		return WritePointers( patches.data( ), patches.size( ) );
+	}
+
+	bool ImportHook::Disable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		// Only restore the slots that weren't redirected again by someone else
+		std::vector<PointerPatch> patches;
+		patches.reserve( slots.size( ) );
+		for( const Slot &slot : slots )
+			if( *slot.address == detour )
+				patches.push_back( { slot.address, slot.original } );
+
+		return WritePointers( patches.data( ), patches.size( ) );
+	}
+
+	void *ImportHook::GetTarget( ) const
+	{
+		return target;
+	}
+
+	void *ImportHook::GetDetour( ) const
+	{
+		return detour;
+	}
+
+	void *ImportHook::GetTrampoline( ) const
+	{
+		return target;
+	}
+
+#if defined SYSTEM_LINUX
+
+	struct GlobalImportRegistry
+	{
+		std::mutex mutex;
+		std::vector<GlobalImportHook *> hooks;
+		unsigned long long adds = 0;
+		unsigned long long subs = 0;
+	};
+
+	// Never destroyed, hooks with static storage might outlive it otherwise
+	static GlobalImportRegistry &GetGlobalImportRegistry( )
+	{
+		static GlobalImportRegistry *registry = new GlobalImportRegistry;
+		return *registry;
+	}
+
+	static bool IsLoaded( const std::vector<Elf::Image> &images, uintptr_t base, const std::string &name )
+	{
+		for( const Elf::Image &image : images )
+			if( image.GetBase( ) == base && image.GetName( ) == name )
+				return true;
+
+		return false;
+	}
+
+	// The loader counts every module it loads and unloads, unchanged counters mean there's nothing new to patch
+	static bool GetLoadCounters( unsigned long long &adds, unsigned long long &subs )
+	{
+		struct Counters
+		{
+			bool valid;
+			unsigned long long adds;
+			unsigned long long subs;
+		} counters = { false, 0, 0 };
+
+		dl_iterate_phdr( []( dl_phdr_info *info, size_t size, void *data ) -> int
+		{
+			Counters &counters = *static_cast<Counters *>( data );
+			if( size >= offsetof( dl_phdr_info, dlpi_subs ) + sizeof( info->dlpi_subs ) )
+			{
+				counters.valid = true;
+				counters.adds = info->dlpi_adds;
+				counters.subs = info->dlpi_subs;
+			}
+
+			return 1;
+		}, &counters );
+
+		adds = counters.adds;
+		subs = counters.subs;
+		return counters.valid;
+	}
+
+#endif
+
+	GlobalImportHook::GlobalImportHook( const std::string &_target, void *_detour )
+	{
+		Create( _target, _detour );
+	}
+
+	GlobalImportHook::~GlobalImportHook( )
+	{
+		Destroy( );
+	}
+
+	bool GlobalImportHook::IsValid( ) const
+	{
+		return target != nullptr && detour != nullptr;
+	}
+
+	bool GlobalImportHook::Create( const std::string &_target, void *_detour )
+	{
+		if( IsValid( ) || _target.empty( ) || _detour == nullptr )
+			return false;
+
+#if defined SYSTEM_LINUX
+
+		void *original = dlsym( RTLD_DEFAULT, _target.c_str( ) );
+		if( original == nullptr )
+			return false;
+
+		target_name = _target;
+		target = original;
+		detour = _detour;
+		return true;
+
+#else
+
+		return false;
+
+#endif
+
+	}
+
+	bool GlobalImportHook::Destroy( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		Disable( );
+
+		target_name.clear( );
+		target = nullptr;
+		detour = nullptr;
+		return true;
+	}
+
+	bool GlobalImportHook::IsEnabled( ) const
+	{
+		return IsValid( ) && enabled;
+	}
+
+	bool GlobalImportHook::Enable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+#if defined SYSTEM_LINUX
+
+		GlobalImportRegistry &registry = GetGlobalImportRegistry( );
+		std::lock_guard lock( registry.mutex );
+
+		if( enabled )
+			return true;
+
+		enabled = true;
+		registry.hooks.push_back( this );
+		Patch( Elf::Image::GetLoaded( ) );
+		return true;
+
+#else
+
+		return false;
+
+#endif
+
+	}
+
+	bool GlobalImportHook::Disable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+#if defined SYSTEM_LINUX
+
+		GlobalImportRegistry &registry = GetGlobalImportRegistry( );
+		std::lock_guard lock( registry.mutex );
+
+		if( !enabled )
+			return true;
+
+		const bool restored = Restore( );
+
+		enabled = false;
+		registry.hooks.erase( std::remove( registry.hooks.begin( ), registry.hooks.end( ), this ), registry.hooks.end( ) );
+		return restored;
+
+#else
+
+		return false;
+
+#endif
+
+	}
+
+	void *GlobalImportHook::GetTarget( ) const
+	{
+		return target;
+	}
+
+	void *GlobalImportHook::GetDetour( ) const
+	{
+		return detour;
+	}
+
+	void *GlobalImportHook::GetTrampoline( ) const
+	{
+		return target;
+	}
+
+	void GlobalImportHook::Refresh( )
+	{
+
+#if defined SYSTEM_LINUX
+
+		GlobalImportRegistry &registry = GetGlobalImportRegistry( );
+		std::lock_guard lock( registry.mutex );
+
+		// Read before listing the modules, anything loaded in between shows up on the next refresh
+		unsigned long long adds = 0, subs = 0;
+		const bool counted = GetLoadCounters( adds, subs );
+		if( counted && adds == registry.adds && subs == registry.subs )
+			return;
+
+		Patch( Elf::Image::GetLoaded( ) );
+
+		if( counted )
+		{
+			registry.adds = adds;
+			registry.subs = subs;
+		}
+
+#endif
+
+	}
+
+#if defined SYSTEM_LINUX
+
+	void GlobalImportHook::Patch( const std::vector<Elf::Image> &images )
+	{
+		GlobalImportRegistry &registry = GetGlobalImportRegistry( );
+
+		// Forget modules that were unloaded, their slots went away with them
+		for( GlobalImportHook *hook : registry.hooks )
+			hook->modules.erase( std::remove_if( hook->modules.begin( ), hook->modules.end( ), [&images]( const Module &module )
+			{
+				return !IsLoaded( images, module.base, module.name );
+			} ), hook->modules.end( ) );
+
+		std::vector<PointerPatch> patches;
+		for( const Elf::Image &image : images )
+		{
+			patches.clear( );
+			for( GlobalImportHook *hook : registry.hooks )
+				hook->Collect( image, patches );
+
+			WritePointers( patches.data( ), patches.size( ) );
+		}
+	}
+
+	void GlobalImportHook::Collect( const Elf::Image &image, std::vector<PointerPatch> &patches )
+	{
+		for( const Module &module : modules )
+			if( module.base == image.GetBase( ) && module.name == image.GetName( ) )
+				return;
+
+		Module module = { image.GetBase( ), image.GetName( ), { } };
+		for( void **address : image.FindImportSlots( target_name ) )
+		{
+			// Leave alone the modules that bound this import to something else
+			void *value = *address;
+			if( value != target && !( image.Contains( value ) && IsLazyBindingStub( value ) ) )
+				continue;
+
+			module.slots.push_back( { address, value } );
+			patches.push_back( { address, detour } );
+		}
+
+		modules.push_back( std::move( module ) );
+	}
+
+	bool GlobalImportHook::Restore( )
+	{
+		const std::vector<Elf::Image> images = Elf::Image::GetLoaded( );
+
+		std::vector<PointerPatch> patches;
+		for( const Module &module : modules )
+		{
+			if( !IsLoaded( images, module.base, module.name ) )
+				continue;
+
+			for( const Slot &slot : module.slots )
+				if( *slot.address == detour )
+					patches.push_back( { slot.address, slot.original } );
+		}
+
+		modules.clear( );
+		return WritePointers( patches.data( ), patches.size( ) );
+	}
+
+#endif
+
+}
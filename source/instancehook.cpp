@@ -0,0 +1,174 @@
+/*************************************************************************
+* Detouring::InstanceHook
+* Virtual table hooks scoped to single objects.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "instancehook.hpp"
+#include "helpers.hpp"
+#include "platform.hpp"
+
+namespace Detouring
+{
+
+	static void **&GetVirtualTablePointer( void *instance )
+	{
+		return *static_cast<void ***>( instance );
+	}
+
+	InstanceHook::InstanceHook( void *_instance )
+	{
+		Create( _instance );
+	}
+
+	InstanceHook::~InstanceHook( )
+	{
+		Destroy( );
+	}
+
+	bool InstanceHook::IsValid( ) const
+	{
+		return instance != nullptr && original_vtable != nullptr && size != 0;
+	}
+
+	bool InstanceHook::Create( void *_instance )
+	{
+		if( IsValid( ) || _instance == nullptr )
+			return false;
+
+		void **vtable = GetVirtualTablePointer( _instance );
+		if( vtable == nullptr )
+			return false;
+
+		const size_t count = GetVirtualTableSize( vtable );
+		if( count == 0 )
+			return false;
+
+		// Copy the entries before the address point too, RTTI, dynamic_cast and virtual bases read them through the object
+		header_size = GetVirtualTablePrefixSize( vtable );
+		shadow_vtable.assign( vtable - header_size, vtable + count );
+		instance = _instance;
+		original_vtable = vtable;
+		size = count;
+		return true;
+	}
+
+	bool InstanceHook::Destroy( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		Disable( );
+
+		instance = nullptr;
+		original_vtable = nullptr;
+		size = 0;
+		header_size = 0;
+		shadow_vtable.clear( );
+		return true;
+	}
+
+	bool InstanceHook::IsEnabled( ) const
+	{
+		return IsValid( ) && GetVirtualTablePointer( instance ) == shadow_vtable.data( ) + header_size;
+	}
+
+	bool InstanceHook::Enable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		void **&vtable = GetVirtualTablePointer( instance );
+		if( vtable == shadow_vtable.data( ) + header_size )
+			return true;
+
+		// The object was destroyed or reconstructed as something else
+		if( vtable != original_vtable )
+			return false;
+
+		vtable = shadow_vtable.data( ) + header_size;
+		return true;
+	}
+
+	bool InstanceHook::Disable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		void **&vtable = GetVirtualTablePointer( instance );
+		if( vtable == shadow_vtable.data( ) + header_size )
+			vtable = original_vtable;
+
+		return true;
+	}
+
+	bool InstanceHook::HookVirtual( size_t index, void *detour )
+	{
+		if( !IsValid( ) || index >= size || detour == nullptr )
+			return false;
+
+		StorePointer( &shadow_vtable[header_size + index], detour );
+		return true;
+	}
+
+	bool InstanceHook::UnHookVirtual( size_t index )
+	{
+		if( !IsValid( ) || index >= size )
+			return false;
+
+		StorePointer( &shadow_vtable[header_size + index], original_vtable[index] );
+		return true;
+	}
+
+	bool InstanceHook::IsHooked( size_t index ) const
+	{
+		return IsValid( ) && index < size && shadow_vtable[header_size + index] != original_vtable[index];
+	}
+
+	void *InstanceHook::GetInstance( ) const
+	{
+		return instance;
+	}
+
+	size_t InstanceHook::GetSize( ) const
+	{
+		return size;
+	}
+
+	void *InstanceHook::GetOriginal( size_t index ) const
+	{
+		if( !IsValid( ) || index >= size )
+			return nullptr;
+
+		return original_vtable[index];
+	}
+}
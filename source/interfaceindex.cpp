@@ -0,0 +1,321 @@
+/*************************************************************************
+* Detouring::InterfaceIndex
+* Indexes CreateInterface registrations by name and version.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "interfaceindex.hpp"
+#include "helpers.hpp"
+#include "platform.hpp"
+#include "disassembler.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined SYSTEM_WINDOWS
+
+#define WIN32_LEAN_AND_MEAN
+
+#include <Windows.h>
+
+#elif defined SYSTEM_LINUX
+
+#include "elf.hpp"
+
+#elif defined SYSTEM_POSIX
+
+#include <dlfcn.h>
+
+#endif
+
+namespace Detouring
+{
+	// Mangled InterfaceReg::s_pInterfaceRegs, exported by most Linux builds of tier1
+	static const char interface_list_symbol[] = "_ZN12InterfaceReg15s_pInterfaceRegsE";
+
+	static void *FindExport( const Hook::Module &module, const char *name )
+	{
+		if( !module.IsValid( ) )
+			return nullptr;
+
+#if defined SYSTEM_WINDOWS
+
+		HMODULE handle = module.IsPointer( ) ?
+			static_cast<HMODULE>( module.GetPointer( ) ) :
+			GetModuleHandleW( module.GetModuleName( ).c_str( ) );
+		if( handle == nullptr )
+			return nullptr;
+
+		return reinterpret_cast<void *>( GetProcAddress( handle, name ) );
+
+#elif defined SYSTEM_LINUX
+
+		const Elf::Image image = Elf::Image::FromModule( module );
+		return image.IsValid( ) ? image.FindSymbolAddress( name ) : nullptr;
+
+#elif defined SYSTEM_POSIX
+
+		if( module.IsPointer( ) )
+			return dlsym( module.GetPointer( ), name );
+
+		void *handle = dlopen( module.GetName( ).c_str( ), RTLD_LAZY | RTLD_NOLOAD );
+		if( handle == nullptr )
+			return nullptr;
+
+		void *address = dlsym( handle, name );
+		dlclose( handle );
+		return address;
+
+#endif
+
+	}
+
+	static bool IsReadable( const void *address, size_t length )
+	{
+		const int32_t first = GetMemoryProtection( const_cast<void *>( address ) );
+		const int32_t last = GetMemoryProtection( const_cast<uint8_t *>( static_cast<const uint8_t *>( address ) ) + length - 1 );
+		return first >= MemoryProtection::None && ( first & MemoryProtection::Read ) != 0 &&
+			last >= MemoryProtection::None && ( last & MemoryProtection::Read ) != 0;
+	}
+
+	// Follows CreateInterface into CreateInterfaceInternal and returns the addresses its loads read from
+	// x86 position independent code reaches data relative to the GOT, pass 0 when there's none
+	static std::vector<void **> FindLoadedAddresses( uint8_t *code, uintptr_t global_offset_table )
+	{
+		std::vector<void **> addresses;
+		for( size_t count = 0; code != nullptr && count < 64; ++count )
+		{
+			InstructionInfo info;
+			const unsigned int length = Disassemble( code, info );
+			if( length == 0 || ( info.flags & F_ERROR ) != 0 )
+				break;
+
+			uint8_t *next = code + length;
+
+			// ret, the list head is loaded long before that
+			if( info.opcode == 0xC3 || info.opcode == 0xC2 )
+				break;
+
+			// jmp rel32 and jmp rel8, CreateInterface usually tail calls CreateInterfaceInternal
+			if( info.opcode == 0xE9 )
+			{
+				int32_t displacement = 0;
+				std::memcpy( &displacement, next - 4, sizeof( displacement ) );
+				code = static_cast<uint8_t *>( FollowJumps( next + displacement ) );
+				continue;
+			}
+
+			if( info.opcode == 0xEB )
+			{
+				code = static_cast<uint8_t *>( FollowJumps( next + static_cast<int8_t>( next[-1] ) ) );
+				continue;
+			}
+
+			// mov or lea reg, [rip + disp32] on x86-64, mov reg, [disp32] on x86
+			// Linkers relax GOT loads of local symbols into lea, which leaves the address of the head
+			if( ( info.opcode == 0x8B || info.opcode == 0x8D ) && info.modrm_mod == 0 && info.modrm_rm == 5 )
+			{
+
+#ifdef ARCHITECTURE_X86_64
+
+				addresses.push_back( reinterpret_cast<void **>( next + static_cast<int32_t>( info.disp.disp32 ) ) );
+
+#else
+
+				addresses.push_back( reinterpret_cast<void **>( static_cast<uintptr_t>( info.disp.disp32 ) ) );
+
+#endif
+
+			}
+
+#ifdef ARCHITECTURE_X86_64
+
+			(void)global_offset_table;
+
+#else
+
+			// mov or lea reg, [reg + disp] with the register holding the GOT (GOT and GOTOFF accesses),
+			// whichever register it is, candidates that aren't registration lists are rejected later
+			if(
+				global_offset_table != 0 && ( info.opcode == 0x8B || info.opcode == 0x8D ) &&
+				( info.modrm_mod == 1 || info.modrm_mod == 2 ) && info.modrm_rm != 4
+			)
+			{
+				const int32_t displacement = info.modrm_mod == 1 ?
+					static_cast<int8_t>( info.disp.disp8 ) :
+					static_cast<int32_t>( info.disp.disp32 );
+				addresses.push_back( reinterpret_cast<void **>( global_offset_table + displacement ) );
+			}
+
+#endif
+
+			code = next;
+		}
+
+		return addresses;
+	}
+
+	InterfaceIndex::InterfaceIndex( const Hook::Module &module )
+	{
+		Create( module );
+	}
+
+	bool InterfaceIndex::IsValid( ) const
+	{
+		return !lists.empty( );
+	}
+
+	InterfaceIndex::Registration *InterfaceIndex::FindRegistrations( const Hook::Module &module )
+	{
+		// Checks the first few nodes look like registrations, anything the disassembly finds has to pass this
+		const auto IsRegistrationList = []( const void *head )
+		{
+			const Registration *registration = static_cast<const Registration *>( head );
+			for( size_t k = 0; k < 4 && registration != nullptr; ++k, registration = registration->next )
+				if( !IsReadable( registration, sizeof( Registration ) ) ||
+					!IsExecutableAddress( reinterpret_cast<void *>( registration->factory ) ) ||
+					!IsReadable( registration->name, 1 ) )
+					return false;
+
+			return head != nullptr;
+		};
+
+		void **head = static_cast<void **>( FindExport( module, interface_list_symbol ) );
+		if( head != nullptr && IsRegistrationList( *head ) )
+			return static_cast<Registration *>( *head );
+
+		uint8_t *code = static_cast<uint8_t *>( FindExport( module, "CreateInterface" ) );
+		if( code == nullptr )
+			return nullptr;
+
+		uintptr_t global_offset_table = 0;
+
+#if defined SYSTEM_LINUX
+
+		global_offset_table = Elf::Image::FromModule( module ).GetGlobalOffsetTable( );
+
+#endif
+
+		for( void **address : FindLoadedAddresses( code, global_offset_table ) )
+		{
+			if( !IsReadable( address, sizeof( void * ) ) )
+				continue;
+
+			if( IsRegistrationList( *address ) )
+				return static_cast<Registration *>( *address );
+
+			// Position independent code may load the address of the head from the GOT first
+			void **slot = static_cast<void **>( *address );
+			if( slot != nullptr && IsReadable( slot, sizeof( void * ) ) && IsRegistrationList( *slot ) )
+				return static_cast<Registration *>( *slot );
+		}
+
+		return nullptr;
+	}
+
+	bool InterfaceIndex::Create( const Hook::Module &module )
+	{
+		Registration *head = FindRegistrations( module );
+		if( head == nullptr )
+			return false;
+
+		for( Registration *list : lists )
+			if( list == head )
+				return true;
+
+		for( Registration *registration = head; registration != nullptr; registration = registration->next )
+		{
+			std::string name = registration->name;
+			if( !factories.emplace( name, registration->factory ).second )
+				continue;
+
+			size_t digits = name.size( );
+			while( digits > 0 && name[digits - 1] >= '0' && name[digits - 1] <= '9' )
+				--digits;
+
+			if( digits == name.size( ) )
+				continue;
+
+			auto it = latest_versions.emplace( name.substr( 0, digits ), name ).first;
+			const std::string &latest = it->second;
+			if( std::strtoul( name.c_str( ) + digits, nullptr, 10 ) > std::strtoul( latest.c_str( ) + digits, nullptr, 10 ) )
+				it->second = std::move( name );
+		}
+
+		lists.push_back( head );
+		return true;
+	}
+
+	bool InterfaceIndex::Destroy( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		lists.clear( );
+		factories.clear( );
+		latest_versions.clear( );
+		return true;
+	}
+
+	size_t InterfaceIndex::GetInterfaceCount( ) const
+	{
+		return factories.size( );
+	}
+
+	std::vector<std::string> InterfaceIndex::GetInterfaceNames( ) const
+	{
+		std::vector<std::string> names;
+		names.reserve( factories.size( ) );
+		for( const auto &entry : factories )
+			names.push_back( entry.first );
+
+		return names;
+	}
+
+	InterfaceIndex::Factory InterfaceIndex::FindFactory( const std::string &name ) const
+	{
+		const auto it = factories.find( name );
+		return it != factories.end( ) ? it->second : nullptr;
+	}
+
+	void *InterfaceIndex::CreateInterface( const std::string &name ) const
+	{
+		Factory factory = FindFactory( name );
+		return factory != nullptr ? factory( ) : nullptr;
+	}
+
+	const std::string *InterfaceIndex::FindLatestVersion( const std::string &base ) const
+	{
+		const auto it = latest_versions.find( base );
+		return it != latest_versions.end( ) ? &it->second : nullptr;
+	}
+}
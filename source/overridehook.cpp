@@ -0,0 +1,159 @@
+/*************************************************************************
+* Detouring::VirtualOverrideHook
+* Redirects a virtual slot in a class and every class derived from it.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "overridehook.hpp"
+#include "helpers.hpp"
+#include "platform.hpp"
+
+namespace Detouring
+{
+	VirtualOverrideHook::VirtualOverrideHook(
+		const VirtualTableIndex &index,
+		void **vtable,
+		size_t slot,
+		void *_detour
+	)
+	{
+		Create( index, vtable, slot, _detour );
+	}
+
+	VirtualOverrideHook::~VirtualOverrideHook( )
+	{
+		Destroy( );
+	}
+
+	bool VirtualOverrideHook::IsValid( ) const
+	{
+		return !slots.empty( ) && detour != nullptr;
+	}
+
+	bool VirtualOverrideHook::Create( const VirtualTableIndex &index, void **vtable, size_t slot, void *_detour )
+	{
+		if( IsValid( ) || vtable == nullptr || _detour == nullptr || slot >= index.GetVirtualTableSize( vtable ) )
+			return false;
+
+		std::vector<VirtualTableIndex::Slot> targets = index.FindDerivedSlots( vtable, slot );
+		targets.insert( targets.begin( ), { vtable, slot } );
+
+		for( const VirtualTableIndex::Slot &target : targets )
+		{
+			void **address = target.vtable + target.index;
+			slots.push_back( { address, *address } );
+			originals[target.vtable] = *address;
+		}
+
+		detour = _detour;
+		return true;
+	}
+
+	bool VirtualOverrideHook::Destroy( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		Disable( );
+
+		slots.clear( );
+		originals.clear( );
+		detour = nullptr;
+		return true;
+	}
+
+	bool VirtualOverrideHook::IsEnabled( ) const
+	{
+		if( !IsValid( ) )
+			return false;
+
+		for( const Slot &slot : slots )
+			if( *slot.address == detour )
+				return true;
+
+		return false;
+	}
+
+	bool VirtualOverrideHook::Enable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		std::vector<PointerPatch> patches;
+		patches.reserve( slots.size( ) );
+		for( const Slot &slot : slots )
+			if( *slot.address == slot.original )
+				patches.push_back( { slot.address, detour } );
+
+		return patches.empty( ) || WritePointers( patches.data( ), patches.size( ) );
+	}
+
+	bool VirtualOverrideHook::Disable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		// Slots patched by someone else since are left alone
+		std::vector<PointerPatch> patches;
+		for( const Slot &slot : slots )
+			if( *slot.address == detour )
+				patches.push_back( { slot.address, slot.original } );
+
+		return patches.empty( ) || WritePointers( patches.data( ), patches.size( ) );
+	}
+
+	size_t VirtualOverrideHook::GetSlotCount( ) const
+	{
+		return slots.size( );
+	}
+
+	void *VirtualOverrideHook::GetDetour( ) const
+	{
+		return detour;
+	}
+
+	void *VirtualOverrideHook::GetOriginal( void **vtable ) const
+	{
+		const auto it = originals.find( vtable );
+		return it != originals.end( ) ? it->second : nullptr;
+	}
+
+	void *VirtualOverrideHook::GetOriginal( const void *instance ) const
+	{
+		if( instance == nullptr || slots.empty( ) )
+			return nullptr;
+
+		// Classes the index doesn't know about inherited the slot unchanged from the base
+		void *original = GetOriginal( *static_cast<void **const *>( instance ) );
+		return original != nullptr ? original : slots.front( ).original;
+	}
+}
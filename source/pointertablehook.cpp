@@ -0,0 +1,197 @@
+/*************************************************************************
+* Detouring::PointerTableHook
+* Batched hooks over arrays of function pointers.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "pointertablehook.hpp"
+
+namespace Detouring
+{
+	PointerTableHook::PointerTableHook( void *_table, size_t _count, size_t _stride )
+	{
+		Create( _table, _count, _stride );
+	}
+
+	PointerTableHook::~PointerTableHook( )
+	{
+		Destroy( );
+	}
+
+	bool PointerTableHook::IsValid( ) const
+	{
+		return table != nullptr && size != 0;
+	}
+
+	bool PointerTableHook::Create( void *_table, size_t _count, size_t _stride )
+	{
+		if( IsValid( ) || _table == nullptr || _count == 0 || _stride < sizeof( void * ) )
+			return false;
+
+		table = static_cast<uint8_t *>( _table );
+		size = _count;
+		stride = _stride;
+		originals.resize( size );
+		for( size_t k = 0; k < size; ++k )
+			originals[k] = *GetSlot( k );
+
+		replacements.assign( size, nullptr );
+		return true;
+	}
+
+	bool PointerTableHook::Destroy( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		UnHookAll( );
+
+		table = nullptr;
+		size = 0;
+		stride = sizeof( void * );
+		originals.clear( );
+		replacements.clear( );
+		return true;
+	}
+
+	bool PointerTableHook::Hook( size_t index, void *replacement )
+	{
+		return Hook( { Slot { index, replacement } } );
+	}
+
+	bool PointerTableHook::Hook( std::initializer_list<Slot> slots )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		std::vector<PointerPatch> patches;
+		patches.reserve( slots.size( ) );
+		for( const Slot &slot : slots )
+		{
+			if( slot.index >= size || slot.replacement == nullptr )
+				return false;
+
+			patches.push_back( { GetSlot( slot.index ), slot.replacement } );
+		}
+
+		if( !WritePointers( patches.data( ), patches.size( ) ) )
+			return false;
+
+		for( const Slot &slot : slots )
+			replacements[slot.index] = slot.replacement;
+
+		return true;
+	}
+
+	bool PointerTableHook::UnHook( size_t index )
+	{
+		return UnHook( { index } );
+	}
+
+	bool PointerTableHook::UnHook( std::initializer_list<size_t> indices )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		std::vector<PointerPatch> patches;
+		patches.reserve( indices.size( ) );
+		for( const size_t index : indices )
+		{
+			if( index >= size )
+				return false;
+
+			// Slots rehooked by someone else since then are left alone
+			void **slot = GetSlot( index );
+			if( replacements[index] != nullptr && *slot == replacements[index] )
+				patches.push_back( { slot, originals[index] } );
+		}
+
+		if( !WritePointers( patches.data( ), patches.size( ) ) )
+			return false;
+
+		for( const size_t index : indices )
+			replacements[index] = nullptr;
+
+		return true;
+	}
+
+	bool PointerTableHook::UnHookAll( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		std::vector<PointerPatch> patches;
+		for( size_t k = 0; k < size; ++k )
+		{
+			void **slot = GetSlot( k );
+			if( replacements[k] != nullptr && *slot == replacements[k] )
+				patches.push_back( { slot, originals[k] } );
+		}
+
+		if( !WritePointers( patches.data( ), patches.size( ) ) )
+			return false;
+
+		replacements.assign( size, nullptr );
+		return true;
+	}
+
+	bool PointerTableHook::IsHooked( size_t index ) const
+	{
+		return IsValid( ) && index < size && replacements[index] != nullptr;
+	}
+
+	size_t PointerTableHook::FindIndex( const void *function ) const
+	{
+		return FindPointer( originals.data( ), size, function );
+	}
+
+	void **PointerTableHook::GetSlot( size_t index ) const
+	{
+		if( !IsValid( ) || index >= size )
+			return nullptr;
+
+		return reinterpret_cast<void **>( table + index * stride );
+	}
+
+	size_t PointerTableHook::GetSize( ) const
+	{
+		return size;
+	}
+
+	void *PointerTableHook::GetOriginal( size_t index ) const
+	{
+		if( !IsValid( ) || index >= size )
+			return nullptr;
+
+		return originals[index];
+	}
+}
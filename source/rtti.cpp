@@ -0,0 +1,376 @@
+/*************************************************************************
+* Detouring::Rtti
+* Virtual table group discovery for the Itanium C++ ABI.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "rtti.hpp"
+#include "helpers.hpp"
+#include "platform.hpp"
+
+#include <cstring>
+
+#if defined SYSTEM_LINUX
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
+#include "elf.hpp"
+
+#include <dlfcn.h>
+
+#endif
+
+namespace Detouring
+{
+	namespace Rtti
+	{
+
+#ifndef COMPILER_VC
+
+		// The _ZTV symbol spans the whole group, without one the scan stays inside the segment
+		static void **GetVirtualTableGroupEnd( void **primary )
+		{
+
+#if defined SYSTEM_LINUX
+
+			Dl_info info = { };
+			void *entry = nullptr;
+			if(
+				dladdr1( primary, &info, &entry, RTLD_DL_SYMENT ) != 0 &&
+				entry != nullptr && info.dli_sname != nullptr && std::strncmp( info.dli_sname, "_ZTV", 4 ) == 0
+			)
+				return reinterpret_cast<void **>(
+					reinterpret_cast<uintptr_t>( info.dli_saddr ) + static_cast<const ElfW( Sym ) *>( entry )->st_size
+				);
+
+			const uintptr_t address = reinterpret_cast<uintptr_t>( primary );
+			for( const Elf::Segment &segment : Elf::Image::FromAddress( primary ).GetSegments( ) )
+				if( address >= segment.start && address - segment.start < segment.size )
+					return reinterpret_cast<void **>( ( segment.start + segment.size ) & ~( sizeof( void * ) - 1 ) );
+
+			return primary;
+
+#else
+
+			// Nothing bounds the group here, so secondary tables aren't looked for
+			return primary;
+
+#endif
+
+		}
+
+#endif
+
+		static std::vector<VirtualTable> CollectVirtualTables( void **primary, void *instance )
+		{
+			std::vector<VirtualTable> tables;
+			const size_t size = GetVirtualTableSize( primary );
+			if( size == 0 )
+				return tables;
+
+			tables.push_back( { 0, primary, size } );
+
+#ifndef COMPILER_VC
+
+			void *typeinfo = primary[-1];
+			if( typeinfo == nullptr )
+				return tables;
+
+			// Each secondary table follows the previous one, preceded by its virtual call and base offsets,
+			// its offset to top and the type info pointer shared by the whole group
+			const intptr_t top = reinterpret_cast<intptr_t>( primary[-2] );
+			void **end = GetVirtualTableGroupEnd( primary );
+			void **cursor = primary + size;
+			while( cursor + 2 < end )
+			{
+				const size_t limit = static_cast<size_t>( end - cursor ) - 2;
+				size_t k = 0;
+				while( k < 64 && k < limit && cursor[k + 1] != typeinfo && IsVirtualTableOffset( cursor[k] ) )
+					++k;
+
+				if( cursor[k + 1] != typeinfo || !IsVirtualTableOffset( cursor[k] ) )
+					break;
+
+				const ptrdiff_t offset = top - reinterpret_cast<intptr_t>( cursor[k] );
+				void **table = cursor + k + 2;
+				if( offset <= 0 || !IsVirtualTableOffset( reinterpret_cast<void *>( offset ) ) || table >= end )
+					break;
+
+				if( instance != nullptr && GetVirtualTable( static_cast<uint8_t *>( instance ) + offset ) != table )
+					break;
+
+				size_t table_size = GetVirtualTableSize( table );
+				if( table_size > static_cast<size_t>( end - table ) )
+					table_size = static_cast<size_t>( end - table );
+
+				if( table_size == 0 )
+					break;
+
+				tables.push_back( { offset, table, table_size } );
+				cursor = table + table_size;
+			}
+
+#else
+
+			(void)instance;
+
+#endif
+
+			return tables;
+		}
+
+		std::vector<VirtualTable> GetVirtualTables( void *instance )
+		{
+			if( instance == nullptr )
+				return { };
+
+			void **primary = GetVirtualTable( instance );
+			if( primary == nullptr )
+				return { };
+
+			return CollectVirtualTables( primary, instance );
+		}
+
+		std::vector<VirtualTable> GetVirtualTableGroup( void **vtable )
+		{
+			if( vtable == nullptr )
+				return { };
+
+			return CollectVirtualTables( vtable, nullptr );
+		}
+
+#if defined SYSTEM_LINUX
+
+		// The address point follows the virtual base and call offsets, the offset to top and the type info
+		// Without RTTI the type info slot is null and reads as an offset, the first entry found is then a method
+		static void **GetAddressPoint( void **start, void **end )
+		{
+			for( void **entry = start; entry < end; ++entry )
+			{
+				if( IsVirtualTableOffset( *entry ) )
+					continue;
+
+				if( !IsExecutableAddress( *entry ) )
+					return entry != start && entry[-1] == nullptr && entry + 1 < end ? entry + 1 : nullptr;
+
+				return entry - start >= 2 && entry[-1] == nullptr && entry[-2] == nullptr ? entry : nullptr;
+			}
+
+			return nullptr;
+		}
+
+		static void **FindVirtualTableBySymbol( const Elf::Image &image, const std::string &name )
+		{
+			const ElfW( Sym ) *symbol = image.FindSymbol( "_ZTV" + name );
+			if( symbol == nullptr || symbol->st_size < 3 * sizeof( void * ) )
+				return nullptr;
+
+			void **start = static_cast<void **>( image.FindSymbolAddress( "_ZTV" + name ) );
+			if( start == nullptr )
+				return nullptr;
+
+			void **end = start + symbol->st_size / sizeof( void * );
+			void *typeinfo = image.FindSymbolAddress( "_ZTI" + name );
+			if( typeinfo != nullptr )
+			{
+				for( void **entry = start; entry < end; ++entry )
+					if( *entry == typeinfo )
+						return entry + 1 < end ? entry + 1 : nullptr;
+
+				return nullptr;
+			}
+
+			return GetAddressPoint( start, end );
+		}
+
+		// Type info objects start with their own virtual table pointer followed by the name,
+		// the class virtual table then references the type info right after an offset to top of zero
+		static void **FindVirtualTableByTypeName( const Elf::Image &image, const std::string &name )
+		{
+			std::vector<Elf::Segment> readable;
+			Elf::SegmentSet executable;
+			for( const Elf::Segment &segment : image.GetSegments( ) )
+			{
+				if( ( segment.protection & MemoryProtection::Read ) != 0 )
+					readable.push_back( segment );
+
+				if( ( segment.protection & MemoryProtection::Execute ) != 0 )
+					executable.Add( segment );
+			}
+
+			executable.Sort( );
+
+			const auto FindReference = [&readable]( const void *value, void **from ) -> void **
+			{
+				for( const Elf::Segment &segment : readable )
+				{
+					void **begin = reinterpret_cast<void **>(
+						( segment.start + sizeof( void * ) - 1 ) & ~( sizeof( void * ) - 1 )
+					);
+					void **end = reinterpret_cast<void **>( segment.start + segment.size ) - 1;
+					if( from >= end )
+						continue;
+
+					void **entry = from > begin ? from : begin;
+					const size_t count = static_cast<size_t>( end - entry );
+					const size_t index = FindPointer( entry, count, value );
+					if( index < count )
+						return entry + index;
+				}
+
+				return nullptr;
+			};
+
+			const size_t length = name.size( ) + 1;
+			for( const Elf::Segment &segment : readable )
+			{
+				const char *begin = reinterpret_cast<const char *>( segment.start );
+				const char *end = begin + segment.size;
+				for(
+					const char *string = begin;
+					end - string >= static_cast<ptrdiff_t>( length );
+					++string
+				)
+				{
+					string = static_cast<const char *>( std::memchr( string, name[0], static_cast<size_t>( end - string ) ) );
+					if( string == nullptr || end - string < static_cast<ptrdiff_t>( length ) )
+						break;
+
+					if( std::memcmp( string, name.c_str( ), length ) != 0 )
+						continue;
+
+					for( void **reference = FindReference( string, nullptr ); reference != nullptr; reference = FindReference( string, reference + 1 ) )
+					{
+						void **typeinfo = reference - 1;
+						for( void **entry = FindReference( typeinfo, nullptr ); entry != nullptr; entry = FindReference( typeinfo, entry + 1 ) )
+							if( entry[-1] == nullptr && executable.Contains( entry[1] ) )
+								return entry + 1;
+					}
+				}
+			}
+
+			return nullptr;
+		}
+
+#endif
+
+		void **FindVirtualTable( const Hook::Module &module, const std::string &name )
+		{
+			if( !module.IsValid( ) || name.empty( ) )
+				return nullptr;
+
+#if defined SYSTEM_LINUX
+
+			const Elf::Image image = Elf::Image::FromModule( module );
+			if( !image.IsValid( ) )
+				return nullptr;
+
+			void **vtable = FindVirtualTableBySymbol( image, name );
+			if( vtable != nullptr )
+				return vtable;
+
+			return FindVirtualTableByTypeName( image, name );
+
+#else
+
+			return nullptr;
+
+#endif
+
+		}
+
+		bool WriteThisAdjustingThunk( void *code, ptrdiff_t offset, void *target, bool returns_in_memory )
+		{
+			if( code == nullptr || target == nullptr || offset < INT32_MIN || offset > INT32_MAX )
+				return false;
+
+			uint8_t *bytes = static_cast<uint8_t *>( code );
+			const int32_t adjustment = static_cast<int32_t>( offset );
+
+#if defined ARCHITECTURE_X86_64
+
+#if defined SYSTEM_WINDOWS
+
+			// sub rcx, imm32
+			const uint8_t subtract[] = { 0x48, 0x81, 0xE9 };
+
+			(void)returns_in_memory;
+
+#else
+
+			// sub rsi, imm32 when rdi holds the result pointer, sub rdi, imm32 otherwise
+			const uint8_t subtract[] = { 0x48, 0x81, static_cast<uint8_t>( returns_in_memory ? 0xEE : 0xEF ) };
+
+#endif
+
+			std::memcpy( bytes, subtract, sizeof( subtract ) );
+			std::memcpy( bytes + 3, &adjustment, sizeof( adjustment ) );
+
+			// jmp qword ptr [rip+0]
+			const uint8_t jump[] = { 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 };
+			std::memcpy( bytes + 7, jump, sizeof( jump ) );
+			std::memcpy( bytes + 13, &target, sizeof( target ) );
+
+#else
+
+#if defined SYSTEM_WINDOWS
+
+			// sub ecx, imm32 (thiscall)
+			const uint8_t subtract[] = { 0x81, 0xE9 };
+			(void)returns_in_memory;
+
+#else
+
+			// sub dword ptr [esp+4], imm32, or [esp+8] past the result pointer
+			const uint8_t subtract[] = { 0x81, 0x6C, 0x24, static_cast<uint8_t>( returns_in_memory ? 0x08 : 0x04 ) };
+
+#endif
+
+			std::memcpy( bytes, subtract, sizeof( subtract ) );
+			std::memcpy( bytes + sizeof( subtract ), &adjustment, sizeof( adjustment ) );
+
+			// jmp rel32
+			uint8_t *jump = bytes + sizeof( subtract ) + sizeof( adjustment );
+			const int32_t displacement = static_cast<int32_t>(
+				reinterpret_cast<intptr_t>( target ) - reinterpret_cast<intptr_t>( jump + 5 )
+			);
+			jump[0] = 0xE9;
+			std::memcpy( jump + 1, &displacement, sizeof( displacement ) );
+
+#endif
+
+			return true;
+		}
+	}
+}
@@ -0,0 +1,309 @@
+/*************************************************************************
+* Detouring::VirtualTableIndex
+* Module wide index of virtual tables and the functions they hold.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "vtableindex.hpp"
+#include "helpers.hpp"
+#include "platform.hpp"
+
+
+#if defined SYSTEM_LINUX
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
+#include "elf.hpp"
+
+#include <dlfcn.h>
+
+#endif
+
+namespace Detouring
+{
+
+#if defined SYSTEM_LINUX
+
+	// Type info objects hold their own virtual table pointer followed by the mangled type name
+	static bool IsTypeInfo( const Elf::SegmentSet &readable, void *typeinfo )
+	{
+		if(
+			typeinfo == nullptr ||
+			( reinterpret_cast<uintptr_t>( typeinfo ) & ( sizeof( void * ) - 1 ) ) != 0 ||
+			!readable.Contains( typeinfo, 2 * sizeof( void * ) )
+		)
+			return false;
+
+		void **object = static_cast<void **>( typeinfo );
+		const char *name = static_cast<const char *>( object[1] );
+		if( object[0] == nullptr || !readable.Contains( name ) )
+			return false;
+
+		return ( name[0] >= '1' && name[0] <= '9' ) || name[0] == 'N' || name[0] == 'S' || name[0] == 'Z';
+	}
+
+	static void *GetTypeInfoVirtualTable( const char *symbol )
+	{
+		void **vtable = static_cast<void **>( dlsym( RTLD_DEFAULT, symbol ) );
+		return vtable != nullptr ? vtable + 2 : nullptr;
+	}
+
+	// Bases at offset zero that aren't virtual, the primary base is one of them
+	static std::vector<void *> GetPrimaryBaseCandidates( void *typeinfo )
+	{
+		static void *single_inheritance = GetTypeInfoVirtualTable( "_ZTVN10__cxxabiv120__si_class_type_infoE" );
+		static void *multiple_inheritance = GetTypeInfoVirtualTable( "_ZTVN10__cxxabiv121__vmi_class_type_infoE" );
+
+		std::vector<void *> bases;
+		void **object = static_cast<void **>( typeinfo );
+		if( single_inheritance != nullptr && object[0] == single_inheritance )
+		{
+			bases.push_back( object[2] );
+		}
+		else if( multiple_inheritance != nullptr && object[0] == multiple_inheritance )
+		{
+			struct BaseInfo
+			{
+				void *type;
+				long offset_flags;
+			};
+
+			const uint8_t *counts = reinterpret_cast<const uint8_t *>( object + 2 );
+			const unsigned int count = reinterpret_cast<const unsigned int *>( counts )[1];
+			const BaseInfo *infos = reinterpret_cast<const BaseInfo *>( counts + 2 * sizeof( unsigned int ) );
+			for( unsigned int k = 0; k < count; ++k )
+				if( ( infos[k].offset_flags & 1 ) == 0 && ( infos[k].offset_flags >> 8 ) == 0 )
+					bases.push_back( infos[k].type );
+		}
+
+		return bases;
+	}
+
+#endif
+
+	VirtualTableIndex::VirtualTableIndex( const Hook::Module &module )
+	{
+		Create( module );
+	}
+
+	bool VirtualTableIndex::IsValid( ) const
+	{
+		return !tables.empty( );
+	}
+
+	bool VirtualTableIndex::Create( const Hook::Module &module )
+	{
+		if( IsValid( ) || !module.IsValid( ) )
+			return false;
+
+#if defined SYSTEM_LINUX
+
+		const Elf::Image image = Elf::Image::FromModule( module );
+		if( !image.IsValid( ) )
+			return false;
+
+		// Virtual functions and type info may come from any loaded module
+		Elf::SegmentSet executable, readable;
+		for( const Elf::Image &loaded : Elf::Image::GetLoaded( ) )
+			for( const Elf::Segment &segment : loaded.GetSegments( ) )
+			{
+				if( ( segment.protection & MemoryProtection::Execute ) != 0 )
+					executable.Add( segment );
+
+				if( ( segment.protection & MemoryProtection::Read ) != 0 )
+					readable.Add( segment );
+			}
+
+		executable.Sort( );
+		readable.Sort( );
+
+		// Linkers may place read only data, virtual tables included, in the executable segment
+		for( const Elf::Segment &segment : image.GetSegments( ) )
+		{
+			if( ( segment.protection & MemoryProtection::Read ) == 0 )
+				continue;
+
+			void **begin = reinterpret_cast<void **>(
+				( segment.start + sizeof( void * ) - 1 ) & ~static_cast<uintptr_t>( sizeof( void * ) - 1 )
+			);
+			void **end = reinterpret_cast<void **>( segment.start + segment.size );
+			for( void **entry = begin + 2; entry < end; ++entry )
+			{
+				if( !IsVirtualTableOffset( entry[-2] ) || !executable.Contains( entry[0] ) || !IsTypeInfo( readable, entry[-1] ) )
+					continue;
+
+				size_t size = 1;
+				while( entry + size < end && executable.Contains( entry[size] ) )
+					++size;
+
+				const size_t position = tables.size( );
+				const bool primary = entry[-2] == nullptr;
+				tables.push_back( { entry, size, entry[-1], primary } );
+				table_indices[entry] = position;
+				if( primary )
+					primary_tables[entry[-1]] = position;
+
+				for( size_t k = 0; k < size; ++k )
+					slots[entry[k]].push_back( { entry, k } );
+
+				entry += size - 1;
+			}
+		}
+
+		for( const Table &table : tables )
+			if( table.primary )
+				for( void *base : GetPrimaryBaseCandidates( table.typeinfo ) )
+					derived_classes[base].push_back( table.typeinfo );
+
+		return IsValid( );
+
+#else
+
+		return false;
+
+#endif
+
+	}
+
+	bool VirtualTableIndex::Destroy( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		tables.clear( );
+		table_indices.clear( );
+		primary_tables.clear( );
+		slots.clear( );
+		derived_classes.clear( );
+		return true;
+	}
+
+	size_t VirtualTableIndex::GetVirtualTableCount( ) const
+	{
+		return tables.size( );
+	}
+
+	std::vector<void **> VirtualTableIndex::GetVirtualTables( ) const
+	{
+		std::vector<void **> vtables;
+		vtables.reserve( tables.size( ) );
+		for( const Table &table : tables )
+			vtables.push_back( table.pointer );
+
+		return vtables;
+	}
+
+	size_t VirtualTableIndex::GetVirtualTableSize( void **vtable ) const
+	{
+		const auto it = table_indices.find( vtable );
+		return it != table_indices.end( ) ? tables[it->second].size : 0;
+	}
+
+	const std::vector<VirtualTableIndex::Slot> &VirtualTableIndex::FindSlots( void *function ) const
+	{
+		static const std::vector<Slot> empty;
+		const auto it = slots.find( function );
+		return it != slots.end( ) ? it->second : empty;
+	}
+
+	size_t VirtualTableIndex::FindIndex( void **vtable, void *function ) const
+	{
+		for( const Slot &slot : FindSlots( function ) )
+			if( slot.vtable == vtable )
+				return slot.index;
+
+		return static_cast<size_t>( ~0 );
+	}
+
+	std::vector<VirtualTableIndex::Slot> VirtualTableIndex::FindOverrides( void **vtable, size_t index ) const
+	{
+		std::vector<Slot> overrides;
+		const auto it = table_indices.find( vtable );
+		if( it == table_indices.end( ) )
+			return overrides;
+
+		const Table &table = tables[it->second];
+		if( !table.primary || index >= table.size )
+			return overrides;
+
+		CollectDerived( table.typeinfo, table.pointer[index], index, true, overrides );
+		return overrides;
+	}
+
+	std::vector<VirtualTableIndex::Slot> VirtualTableIndex::FindDerivedSlots( void **vtable, size_t index ) const
+	{
+		std::vector<Slot> derived;
+		const auto it = table_indices.find( vtable );
+		if( it == table_indices.end( ) )
+			return derived;
+
+		const Table &table = tables[it->second];
+		if( !table.primary || index >= table.size )
+			return derived;
+
+		CollectDerived( table.typeinfo, table.pointer[index], index, false, derived );
+		return derived;
+	}
+
+	void VirtualTableIndex::CollectDerived(
+		void *typeinfo,
+		void *function,
+		size_t index,
+		bool overrides_only,
+		std::vector<Slot> &derived
+	) const
+	{
+		const auto it = derived_classes.find( typeinfo );
+		if( it == derived_classes.end( ) )
+			return;
+
+		for( void *derived_class : it->second )
+		{
+			const auto primary = primary_tables.find( derived_class );
+			if( primary == primary_tables.end( ) )
+				continue;
+
+			const Table &table = tables[primary->second];
+			if( index >= table.size )
+				continue;
+
+			void *entry = table.pointer[index];
+			if( !overrides_only || entry != function )
+				derived.push_back( { table.pointer, index } );
+
+			// Classes further down override what their parent has in the slot
+			CollectDerived( derived_class, entry, index, overrides_only, derived );
+		}
+	}
+}
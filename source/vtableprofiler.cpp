@@ -0,0 +1,149 @@
+/*************************************************************************
+* Detouring::VirtualTableProfiler
+* Counts calls going through each slot of a virtual table.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "vtableprofiler.hpp"
+
+namespace Detouring
+{
+	VirtualTableProfiler::VirtualTableProfiler( void **_vtable, size_t _size, bool _measure_cycles )
+	{
+		Create( _vtable, _size, _measure_cycles );
+	}
+
+	VirtualTableProfiler::~VirtualTableProfiler( )
+	{
+		Destroy( );
+	}
+
+	bool VirtualTableProfiler::IsValid( ) const
+	{
+		return vtable != nullptr && profiler.IsValid( );
+	}
+
+	bool VirtualTableProfiler::Create( void **_vtable, size_t _size, bool _measure_cycles )
+	{
+		if( IsValid( ) || _vtable == nullptr )
+			return false;
+
+		if( _size == 0 )
+			_size = GetVirtualTableSize( _vtable );
+
+		if( _size == 0 || !profiler.Create( _vtable, _size, _measure_cycles, _vtable ) )
+			return false;
+
+		vtable = _vtable;
+		return true;
+	}
+
+	bool VirtualTableProfiler::Destroy( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		Disable( );
+
+		profiler.Destroy( );
+		vtable = nullptr;
+		return true;
+	}
+
+	bool VirtualTableProfiler::IsEnabled( ) const
+	{
+		return IsValid( ) && vtable[0] == profiler.GetStub( 0 );
+	}
+
+	bool VirtualTableProfiler::Enable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		const size_t size = profiler.GetSize( );
+		std::vector<PointerPatch> patches;
+		patches.reserve( size );
+		for( size_t k = 0; k < size; ++k )
+			if( vtable[k] == profiler.GetTarget( k ) )
+				patches.push_back( { vtable + k, profiler.GetStub( k ) } );
+
+		return WritePointers( patches.data( ), patches.size( ) );
+	}
+
+	bool VirtualTableProfiler::Disable( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		// Slots hooked by someone else since then are left alone
+		const size_t size = profiler.GetSize( );
+		std::vector<PointerPatch> patches;
+		patches.reserve( size );
+		for( size_t k = 0; k < size; ++k )
+			if( vtable[k] == profiler.GetStub( k ) )
+				patches.push_back( { vtable + k, profiler.GetTarget( k ) } );
+
+		return WritePointers( patches.data( ), patches.size( ) );
+	}
+
+	size_t VirtualTableProfiler::GetSize( ) const
+	{
+		return profiler.GetSize( );
+	}
+
+	void *VirtualTableProfiler::GetOriginal( size_t index ) const
+	{
+		return profiler.GetTarget( index );
+	}
+
+	std::vector<VirtualTableProfiler::Result> VirtualTableProfiler::GetResults( ) const
+	{
+		std::vector<Result> results;
+		if( !IsValid( ) )
+			return results;
+
+		const size_t size = profiler.GetSize( );
+		results.reserve( size );
+		for( size_t k = 0; k < size; ++k )
+		{
+			const CallProfiler::Result result = profiler.GetResult( k );
+			results.push_back( { k, profiler.GetTarget( k ), result.calls, result.cycles } );
+		}
+
+		return results;
+	}
+
+	void VirtualTableProfiler::Reset( )
+	{
+		profiler.Reset( );
+	}
+}
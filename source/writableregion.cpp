@@ -0,0 +1,124 @@
+/*************************************************************************
+* Detouring::WritableRegion
+* Keeps a range of pages writable so pointers in it can be swapped without syscalls.
+*------------------------------------------------------------------------
+* Copyright (c) 2017-2022, Daniel Almeida
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions
+* are met:
+*
+* 1. Redistributions of source code must retain the above copyright
+* notice, this list of conditions and the following disclaimer.
+*
+* 2. Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+*
+* 3. Neither the name of the copyright holder nor the names of its
+* contributors may be used to endorse or promote products derived from
+* this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************/
+
+#include "writableregion.hpp"
+
+namespace Detouring
+{
+	WritableRegion::WritableRegion( void *address, size_t length )
+	{
+		Create( address, length );
+	}
+
+	WritableRegion::~WritableRegion( )
+	{
+		Destroy( );
+	}
+
+	bool WritableRegion::IsValid( ) const
+	{
+		return start != 0 && end > start;
+	}
+
+	bool WritableRegion::Create( void *address, size_t length )
+	{
+		if( IsValid( ) || address == nullptr || length == 0 )
+			return false;
+
+		const uintptr_t page_size = GetPageSize( );
+		const uintptr_t page_mask = ~( page_size - 1 );
+		const uintptr_t first = reinterpret_cast<uintptr_t>( address ) & page_mask;
+		const uintptr_t last = ( reinterpret_cast<uintptr_t>( address ) + length + page_size - 1 ) & page_mask;
+
+		const int32_t current = GetMemoryProtection(
+			reinterpret_cast<void *>( first ),
+			static_cast<size_t>( last - first )
+		);
+		if( current < MemoryProtection::None )
+			return false;
+
+		if( ( current & MemoryProtection::Write ) == 0 &&
+			!SetMemoryProtection(
+				reinterpret_cast<void *>( first ),
+				static_cast<size_t>( last - first ),
+				current | MemoryProtection::Write
+			) )
+			return false;
+
+		start = first;
+		end = last;
+		protection = current;
+		return true;
+	}
+
+	bool WritableRegion::Destroy( )
+	{
+		if( !IsValid( ) )
+			return false;
+
+		if( ( protection & MemoryProtection::Write ) == 0 )
+			SetMemoryProtection( reinterpret_cast<void *>( start ), static_cast<size_t>( end - start ), protection );
+
+		start = 0;
+		end = 0;
+		protection = MemoryProtection::Error;
+		return true;
+	}
+
+	bool WritableRegion::Contains( const void *address, size_t length ) const
+	{
+		const uintptr_t first = reinterpret_cast<uintptr_t>( address );
+		return IsValid( ) && first >= start && first < end && length <= end - first;
+	}
+
+	bool WritableRegion::Store( void **slot, void *value )
+	{
+		if( !Contains( slot ) )
+			return false;
+
+		StorePointer( slot, value );
+		return true;
+	}
+
+	void *WritableRegion::Exchange( void **slot, void *value )
+	{
+		return Contains( slot ) ? ExchangePointer( slot, value ) : nullptr;
+	}
+
+	bool WritableRegion::CompareExchange( void **slot, void *&expected, void *desired )
+	{
+		return Contains( slot ) && CompareExchangePointer( slot, expected, desired );
+	}
+}